@@ -0,0 +1,407 @@
+/*
+ * desbench.c - Micro-benchmarks for the DES utility functions
+ *
+ * Built by 'make bench'. desutils.c is included whole so that the
+ * static internals (desfunc, scrunch, unscrun, rawkey, cookey...) can
+ * be timed on their own, not only through the public calls.
+ *
+ * Each benchmark runs a loop of st->iters iterations. The runner grows
+ * iters until one run lasts at least the minimum time, then reports
+ * wall and CPU time per iteration, as Google Benchmark does. Results
+ * that would otherwise be dead go through DO_NOT_OPTIMIZE(), and
+ * CLOBBER_MEMORY() stops the compiler caching memory across calls.
+ *
+ * Usage: desbench [-t seconds] [filter...]
+ * Only benchmarks whose name contains one of the filters are run.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "desutils.c"
+#include "deshex.h"
+#include "testdes.h"
+
+/* Make the compiler assume x is read, and possibly changed, here */
+#define DO_NOT_OPTIMIZE(x)	__asm__ __volatile__("" : : "g"(x) : "memory")
+/* Make it assume all memory may have been read or written */
+#define CLOBBER_MEMORY()	__asm__ __volatile__("" : : : "memory")
+
+#define BENCH_MIN_TIME	0.5	/* Seconds per benchmark by default */
+#define BENCH_BUF	65536	/* Largest buffer argument */
+#define BENCH_KEYS	64	/* Keys the multi-key benchmarks cycle through */
+
+typedef struct {
+	long iters;		/* Iterations to run */
+	long arg;		/* Buffer size in bytes, 0 if none */
+	long bytes;		/* Bytes done per iteration, set by the benchmark */
+} bench_state;
+
+typedef void (*bench_fn)(bench_state *);
+
+static des_ctx dc;
+static des3_ctx d3;
+static unsigned char key[24] = {
+	0x01,0x23,0x45,0x67,0x89,0xab,0xcd,0xef,
+	0x23,0x45,0x67,0x89,0xab,0xcd,0xef,0x01,
+	0x45,0x67,0x89,0xab,0xcd,0xef,0x01,0x23 };
+static unsigned char buf[BENCH_BUF] DES_ALIGN;
+static unsigned char iv[8];
+static char hexbuf[BENCH_BUF * 2];
+
+/* Multi-key ECB: one block per message, message i under key i % BENCH_KEYS */
+static des_ctx mdc[BENCH_KEYS];
+static des3_ctx md3[BENCH_KEYS];
+static des_ctx *mdp[BENCH_BUF / 8];
+static des3_ctx *md3p[BENCH_BUF / 8];
+static unsigned char *mbufs[BENCH_BUF / 8];
+static int mlens[BENCH_BUF / 8];
+
+static void bm_desfunc(bench_state *st)
+{
+	uint32_t work[2] = { 0x01234567L, 0x89abcdefL };
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		desfunc(work, dc.ek);
+		DO_NOT_OPTIMIZE(work[0]);
+	}
+	st->bytes = 8;
+}
+
+static void bm_desfunc3(bench_state *st)
+{
+	uint32_t work[2] = { 0x01234567L, 0x89abcdefL };
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		desfunc3(work, d3.ek1, d3.dk2, d3.ek3);
+		DO_NOT_OPTIMIZE(work[0]);
+	}
+	st->bytes = 8;
+}
+
+static void bm_desfunc4(bench_state *st)
+{
+	uint32_t work[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		desfunc4(work, dc.ek, NULL, NULL);
+		CLOBBER_MEMORY();
+	}
+	st->bytes = 32;
+}
+
+static void bm_scrunch(bench_state *st)
+{
+	uint32_t work[2];
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		scrunch(buf + (i & 7) * 8, work);
+		DO_NOT_OPTIMIZE(work[0]);
+		DO_NOT_OPTIMIZE(work[1]);
+	}
+	st->bytes = 8;
+}
+
+static void bm_unscrun(bench_state *st)
+{
+	uint32_t work[2] = { 0x01234567L, 0x89abcdefL };
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		work[0] += i;
+		unscrun(work, buf);
+		CLOBBER_MEMORY();
+	}
+	st->bytes = 8;
+}
+
+static void bm_deskey(bench_state *st)
+{
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		key[7] = i;
+		deskey(key, EN0);
+		CLOBBER_MEMORY();
+	}
+}
+
+static void bm_rawkey(bench_state *st)
+{
+	uint32_t raw[32];
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		key[7] = i;
+		rawkey(key, raw);
+		CLOBBER_MEMORY();
+	}
+}
+
+static void bm_cookey(bench_state *st)
+{
+	uint32_t raw[32], cook[32];
+	long i;
+
+	rawkey(key, raw);
+	for( i = 0; i < st->iters; i++ )
+	{
+		raw[0] = i;
+		cookey(raw, cook);
+		CLOBBER_MEMORY();
+	}
+}
+
+static void bm_des_key(bench_state *st)
+{
+	des_ctx c;
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		key[7] = i;
+		des_key(&c, key);
+		CLOBBER_MEMORY();
+	}
+}
+
+static void bm_des3_key(bench_state *st)
+{
+	des3_ctx c;
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		key[7] = i;
+		des3_key3(&c, key);
+		CLOBBER_MEMORY();
+	}
+}
+
+static void bm_pack_key(bench_state *st)
+{
+	unsigned char out[8];
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		pack_key((unsigned char *)hexbuf + (i & 7) * 16, out);
+		CLOBBER_MEMORY();
+	}
+	st->bytes = 8;
+}
+
+/* The old one digit at a time path, to compare against pack_key */
+static void bm_pack_key_legacy(bench_state *st)
+{
+	unsigned char out[8];
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		pack_key_legacy((unsigned char *)hexbuf + (i & 7) * 16, out);
+		CLOBBER_MEMORY();
+	}
+	st->bytes = 8;
+}
+
+static void bm_hex_decode(bench_state *st)
+{
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		DO_NOT_OPTIMIZE(des_hex_decode(hexbuf, buf, st->arg));
+		CLOBBER_MEMORY();
+	}
+	st->bytes = st->arg;
+}
+
+static void bm_hex_encode(bench_state *st)
+{
+	long i;
+
+	for( i = 0; i < st->iters; i++ )
+	{
+		des_hex_encode(buf, hexbuf, st->arg);
+		CLOBBER_MEMORY();
+	}
+	st->bytes = st->arg;
+}
+
+/* The mode functions, in place over st->arg bytes */
+#define BM_MODE(name, call) \
+static void bm_##name(bench_state *st) \
+{ \
+	int blocks = st->arg / 8; \
+	long i; \
+	for( i = 0; i < st->iters; i++ ) \
+	{ \
+		call; \
+		CLOBBER_MEMORY(); \
+	} \
+	st->bytes = st->arg; \
+}
+
+BM_MODE(des_enc, des_enc(&dc, buf, blocks))
+BM_MODE(des_dec, des_dec(&dc, buf, blocks))
+BM_MODE(des3_enc, des3_enc(&d3, buf, blocks))
+BM_MODE(des3_dec, des3_dec(&d3, buf, blocks))
+BM_MODE(des_enc_multi, des_enc_multi(mdp, mbufs, mlens, blocks))
+BM_MODE(des3_enc_multi, des3_enc_multi(md3p, mbufs, mlens, blocks))
+BM_MODE(des_cbc_enc, des_cbc_enc(&dc, iv, buf, blocks))
+BM_MODE(des_cbc_dec, des_cbc_dec(&dc, iv, buf, blocks))
+BM_MODE(des3_cbc_enc, des3_cbc_enc(&d3, iv, buf, blocks))
+BM_MODE(des3_cbc_dec, des3_cbc_dec(&d3, iv, buf, blocks))
+BM_MODE(des_ctr, des_ctr(&dc, iv, buf, blocks * 8))
+BM_MODE(des3_ctr, des3_ctr(&d3, iv, buf, blocks * 8))
+
+/* Benchmarks and the buffer sizes each is run at; 0 ends the list,
+   and a list of just 0 runs it once with no size */
+static struct {
+	const char *name;
+	bench_fn fn;
+	long args[4];
+} benches[] = {
+	{ "desfunc",      bm_desfunc,      { 0 } },
+	{ "desfunc3",     bm_desfunc3,     { 0 } },
+	{ "desfunc4",     bm_desfunc4,     { 0 } },
+	{ "scrunch",      bm_scrunch,      { 0 } },
+	{ "unscrun",      bm_unscrun,      { 0 } },
+	{ "deskey",       bm_deskey,       { 0 } },
+	{ "rawkey",       bm_rawkey,       { 0 } },
+	{ "cookey",       bm_cookey,       { 0 } },
+	{ "des_key",      bm_des_key,      { 0 } },
+	{ "des3_key3",    bm_des3_key,     { 0 } },
+	{ "pack_key",     bm_pack_key,     { 0 } },
+	{ "pack_key_legacy", bm_pack_key_legacy, { 0 } },
+	{ "hex_decode",   bm_hex_decode,   { 8, 4096, 0 } },
+	{ "hex_encode",   bm_hex_encode,   { 8, 4096, 0 } },
+	{ "des_enc",      bm_des_enc,      { 8, 4096, 65536, 0 } },
+	{ "des_dec",      bm_des_dec,      { 8, 4096, 65536, 0 } },
+	{ "des3_enc",     bm_des3_enc,     { 8, 4096, 65536, 0 } },
+	{ "des3_dec",     bm_des3_dec,     { 8, 4096, 65536, 0 } },
+	{ "des_enc_multi",  bm_des_enc_multi,  { 8, 4096, 65536, 0 } },
+	{ "des3_enc_multi", bm_des3_enc_multi, { 8, 4096, 65536, 0 } },
+	{ "des_cbc_enc",  bm_des_cbc_enc,  { 8, 4096, 65536, 0 } },
+	{ "des_cbc_dec",  bm_des_cbc_dec,  { 8, 4096, 65536, 0 } },
+	{ "des3_cbc_enc", bm_des3_cbc_enc, { 8, 4096, 65536, 0 } },
+	{ "des3_cbc_dec", bm_des3_cbc_dec, { 8, 4096, 65536, 0 } },
+	{ "des_ctr",      bm_des_ctr,      { 8, 4096, 65536, 0 } },
+	{ "des3_ctr",     bm_des3_ctr,     { 8, 4096, 65536, 0 } },
+	{ NULL,           NULL,            { 0 } }
+};
+
+static double now(clockid_t clk)
+{
+	struct timespec ts;
+
+	clock_gettime(clk, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Run fn for at least mintime seconds and print one result line */
+static void run(const char *name, bench_fn fn, long arg, double mintime)
+{
+	bench_state st;
+	double wall, cpu;
+	char label[64];
+
+	st.arg = arg;
+	for( st.iters = 1; ; st.iters *= 2 )
+	{
+		st.bytes = 0;
+		wall = now(CLOCK_MONOTONIC);
+		cpu = now(CLOCK_PROCESS_CPUTIME_ID);
+		fn(&st);
+		wall = now(CLOCK_MONOTONIC) - wall;
+		cpu = now(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+		if( wall >= mintime || st.iters >= (1L << 40) )
+			break;
+		/* Jump most of the way once the timer is meaningful */
+		if( wall > mintime / 100 )
+			st.iters = st.iters * (mintime * 1.2 / wall) / 2 + 1;
+	}
+
+	if( arg )
+		snprintf(label, sizeof(label), "BM_%s/%ld", name, arg);
+	else
+		snprintf(label, sizeof(label), "BM_%s", name);
+	printf("%-24s %10.1f ns %10.1f ns %12ld", label,
+		wall * 1e9 / st.iters, cpu * 1e9 / st.iters, st.iters);
+	if( st.bytes )
+		printf(" %9.1f MB/s", st.bytes * st.iters / wall / 1e6);
+	printf("\n");
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	double mintime = BENCH_MIN_TIME;
+	int i, j, k, first = 1, want;
+
+	if( argc > 2 && strcmp(argv[1], "-t") == 0 )
+	{
+		mintime = atof(argv[2]);
+		argv += 2;
+		argc -= 2;
+	}
+
+	des_key(&dc, key);
+	des3_key3(&d3, key);
+	for( i = 0; i < BENCH_BUF; i++ )
+		buf[i] = i * 7;
+	des_hex_encode(buf, hexbuf, BENCH_BUF);
+	for( i = 0; i < BENCH_KEYS; i++ )
+	{
+		key[0] = i;
+		des_key(&mdc[i], key);
+		des3_key3(&md3[i], key);
+	}
+	key[0] = 0x01;
+	for( i = 0; i < BENCH_BUF / 8; i++ )
+	{
+		mdp[i] = &mdc[i % BENCH_KEYS];
+		md3p[i] = &md3[i % BENCH_KEYS];
+		mbufs[i] = buf + i * 8;
+		mlens[i] = 1;
+	}
+
+	for( i = 0; benches[i].name != NULL; i++ )
+	{
+		want = argc < 2;
+		for( j = 1; j < argc; j++ )
+			if( strstr(benches[i].name, argv[j]) != NULL )
+				want = 1;
+		if( !want )
+			continue;
+		if( first )
+		{
+			printf("kernel %s, hex %s, %.2f s per benchmark\n",
+				des_kernel_name(), des_hex_impl(), mintime);
+			printf("%-24s %13s %13s %12s %14s\n", "Benchmark",
+				"Time", "CPU", "Iterations", "Throughput");
+			first = 0;
+		}
+		k = 0;
+		do
+			run(benches[i].name, benches[i].fn, benches[i].args[k], mintime);
+		while( benches[i].args[k] != 0 && benches[i].args[++k] != 0 );
+	}
+	return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * desbs.c - Bitsliced DES engine for the DES Test Program
+ *
+ * Encrypts BS_LANES independent blocks per pass. The blocks are
+ * transposed so that word i holds bit i of every block, and each round
+ * is then evaluated with the boolean S-box circuits in desbs_sbox.h.
+ * There are no table lookups, so the timing of this path does not
+ * depend on the key or the data.
+ *
+ * This file is compiled once per kernel. With no DES_BS_WIDTH the
+ * word is a plain uint64_t (the portable "scalar" kernel); the Makefile
+ * also builds it with DES_BS_WIDTH=128/256/512 and the matching -m
+ * flags, giving SSE2, AVX2 and AVX-512 words of 2, 4 or 8 lanes of 64
+ * blocks. desutils.c picks one at run time.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#include <stdint.h>
+#include "desutils.h"
+#include "desbs.h"
+
+#if !defined(DES_BS_WIDTH) || DES_BS_WIDTH == 64
+typedef uint64_t BSW;		/* One bit from each of 64 blocks */
+#define BS_WORDS	1
+#define BS_SET(w, g, v)	((w) = (v))
+#define BS_GET(w, g)	(w)
+#define BS_FN(f)	f##_scalar
+#else
+typedef uint64_t BSW __attribute__((vector_size(DES_BS_WIDTH / 8)));
+#define BS_WORDS	(DES_BS_WIDTH / 64)
+#define BS_SET(w, g, v)	((w)[g] = (v))
+#define BS_GET(w, g)	((w)[g])
+#if DES_BS_WIDTH == 128
+#define BS_FN(f)	f##_sse2
+#elif DES_BS_WIDTH == 256
+#define BS_FN(f)	f##_avx2
+#elif DES_BS_WIDTH == 512
+#define BS_FN(f)	f##_avx512
+#else
+#error "DES_BS_WIDTH must be 64, 128, 256 or 512"
+#endif
+#endif
+
+#define BS_LANES	(BS_WORDS * 64)	/* Blocks per pass */
+
+#include "desbs_sbox.h"
+
+/* Standard DES bit tables (FIPS 46-3), 0-based, bit 0 = MSB of the
+ * block. bs_pinv[] is the inverse of P: pre-P bit n ends up in bit
+ * bs_pinv[n] of the round function output.
+ */
+static const unsigned char bs_ip[64] = {
+	57, 49, 41, 33, 25, 17,  9,  1, 59, 51, 43, 35, 27, 19, 11,  3,
+	61, 53, 45, 37, 29, 21, 13,  5, 63, 55, 47, 39, 31, 23, 15,  7,
+	56, 48, 40, 32, 24, 16,  8,  0, 58, 50, 42, 34, 26, 18, 10,  2,
+	60, 52, 44, 36, 28, 20, 12,  4, 62, 54, 46, 38, 30, 22, 14,  6 };
+
+static const unsigned char bs_fp[64] = {
+	39,  7, 47, 15, 55, 23, 63, 31, 38,  6, 46, 14, 54, 22, 62, 30,
+	37,  5, 45, 13, 53, 21, 61, 29, 36,  4, 44, 12, 52, 20, 60, 28,
+	35,  3, 43, 11, 51, 19, 59, 27, 34,  2, 42, 10, 50, 18, 58, 26,
+	33,  1, 41,  9, 49, 17, 57, 25, 32,  0, 40,  8, 48, 16, 56, 24 };
+
+static const unsigned char bs_e[48] = {
+	31,  0,  1,  2,  3,  4,  3,  4,  5,  6,  7,  8,
+	 7,  8,  9, 10, 11, 12, 11, 12, 13, 14, 15, 16,
+	15, 16, 17, 18, 19, 20, 19, 20, 21, 22, 23, 24,
+	23, 24, 25, 26, 27, 28, 27, 28, 29, 30, 31,  0 };
+
+static const unsigned char bs_pinv[32] = {
+	 8, 16, 22, 30, 12, 27,  1, 17, 23, 15, 29,  5, 25, 19,  9,  0,
+	 7, 13, 24,  2,  3, 28, 10, 18, 31, 11, 21,  6,  4, 26, 14, 20 };
+
+/* Recover the 16 48-bit subkeys (bit 47 = first E bit) from a cooked
+ * key schedule; this undoes cookey(). Works on ek or dk alike.
+ */
+static void bs_subkeys(uint32_t *cooked, uint64_t *sk)
+{
+	register uint32_t c0, c1, raw0, raw1;
+	register int i;
+
+	for( i = 0; i < 16; i++ )
+	{
+		c0 = *cooked++;
+		c1 = *cooked++;
+		raw0  = (c0 >> 6) & 0x00fc0000L;
+		raw0 |= (c0 >> 10) & 0x00000fc0L;
+		raw0 |= (c1 >> 12) & 0x0003f000L;
+		raw0 |= (c1 >> 16) & 0x0000003fL;
+		raw1  = (c0 << 10) & 0x00fc0000L;
+		raw1 |= (c0 << 6) & 0x00000fc0L;
+		raw1 |= (c1 << 4) & 0x0003f000L;
+		raw1 |= c1 & 0x0000003fL;
+		sk[i] = ((uint64_t)raw0 << 24) | raw1;
+	}
+}
+
+/* 64x64 bit matrix transpose: bit c of a[r] swaps with bit r of a[c] */
+static void bs_transpose(uint64_t *a)
+{
+	register int j, k;
+	register uint64_t m, t;
+
+	for( j = 32, m = 0x00000000ffffffffULL; j; j >>= 1, m ^= m << j )
+	{
+		for( k = 0; k < 64; k = ((k | j) + 1) & ~j )
+		{
+			t = ((a[k] >> j) ^ a[k | j]) & m;
+			a[k | j] ^= t;
+			a[k] ^= t << j;
+		}
+	}
+}
+
+/* Key bit j of subkey k as an all-zeros or all-ones word */
+#define BS_KEY(k, j)	(zero - (uint64_t)(((k) >> (47 - (j))) & 1))
+
+#define BS_SBOX(f, n, L, R, k) \
+	f(R[bs_e[6*n]] ^ BS_KEY(k, 6*n), R[bs_e[6*n+1]] ^ BS_KEY(k, 6*n+1), \
+	  R[bs_e[6*n+2]] ^ BS_KEY(k, 6*n+2), R[bs_e[6*n+3]] ^ BS_KEY(k, 6*n+3), \
+	  R[bs_e[6*n+4]] ^ BS_KEY(k, 6*n+4), R[bs_e[6*n+5]] ^ BS_KEY(k, 6*n+5), \
+	  &L[bs_pinv[4*n]], &L[bs_pinv[4*n+1]], \
+	  &L[bs_pinv[4*n+2]], &L[bs_pinv[4*n+3]])
+
+/* 16 rounds on the bitsliced halves. On return *lp and *rp have been
+ * exchanged after every round, as in the Feistel network, so *lp is
+ * L16 and *rp is R16.
+ */
+static void bs_rounds(BSW **lp, BSW **rp, uint64_t *sk)
+{
+	register BSW *L, *R, *T;
+	register uint64_t k;
+	register int round;
+	BSW zero = { 0 };
+
+	L = *lp;
+	R = *rp;
+	for( round = 0; round < 16; round++ )
+	{
+		k = sk[round];
+		BS_SBOX(s1, 0, L, R, k);
+		BS_SBOX(s2, 1, L, R, k);
+		BS_SBOX(s3, 2, L, R, k);
+		BS_SBOX(s4, 3, L, R, k);
+		BS_SBOX(s5, 4, L, R, k);
+		BS_SBOX(s6, 5, L, R, k);
+		BS_SBOX(s7, 6, L, R, k);
+		BS_SBOX(s8, 7, L, R, k);
+		T = L; L = R; R = T;
+	}
+	*lp = L;
+	*rp = R;
+}
+
+/* Run one or three DES passes over BS_LANES blocks at cp. With
+ * three passes, FP/IP between them cancel and only the halves swap.
+ */
+static void bs_block(unsigned char *cp, uint64_t sk[][16], int passes)
+{
+	uint64_t a[64];
+	BSW planes[64], lbuf[32], rbuf[32];
+	BSW *L, *R, *T;
+	register uint64_t v;
+	register int i, j, g;
+
+	/* Each group of 64 blocks becomes one 64-bit lane of every plane */
+	for( g = 0; g < BS_WORDS; g++ )
+	{
+		for( i = 0; i < 64; i++ )
+		{
+			for( v = 0, j = 0; j < 8; j++ )
+				v = (v << 8) | cp[((g << 6) + i) * 8 + j];
+			a[i] = v;
+		}
+		bs_transpose(a);
+		for( i = 0; i < 64; i++ )
+			BS_SET(planes[i], g, a[63 - i]);
+	}
+
+	L = lbuf;
+	R = rbuf;
+	for( i = 0; i < 32; i++ )
+	{
+		L[i] = planes[bs_ip[i]];
+		R[i] = planes[bs_ip[32 + i]];
+	}
+
+	for( i = 0; i < passes; i++ )
+	{
+		if( i > 0 )
+		{
+			T = L; L = R; R = T;
+		}
+		bs_rounds(&L, &R, sk[i]);
+	}
+
+	/* Pre-output is R16 L16; FP is applied while storing the planes */
+	for( i = 0; i < 64; i++ )
+		planes[i] = bs_fp[i] < 32 ? R[bs_fp[i]] : L[bs_fp[i] - 32];
+
+	for( g = 0; g < BS_WORDS; g++ )
+	{
+		for( i = 0; i < 64; i++ )
+			a[63 - i] = BS_GET(planes[i], g);
+		bs_transpose(a);
+		for( i = 0; i < 64; i++ )
+		{
+			v = a[i];
+			for( j = 7; j >= 0; j--, v >>= 8 )
+				cp[((g << 6) + i) * 8 + j] = v & 0xff;
+		}
+	}
+}
+
+/* Single DES over blocks (a multiple of BS_LANES) in place, keys
+ * is a cooked schedule (ek to encrypt, dk to decrypt).
+ */
+void BS_FN(des_bs_ecb)(uint32_t *keys, unsigned char *data, int blocks)
+{
+	uint64_t sk[1][16];
+
+	bs_subkeys(keys, sk[0]);
+	for( ; blocks >= BS_LANES; blocks -= BS_LANES )
+	{
+		bs_block(data, sk, 1);
+		data += BS_LANES * 8;
+	}
+}
+
+/* Triple DES over blocks (a multiple of BS_LANES) in place, k1,k2,k3
+ * are the cooked schedules for the three passes.
+ */
+void BS_FN(des_bs_ecb3)(uint32_t *k1, uint32_t *k2, uint32_t *k3,
+			unsigned char *data, int blocks)
+{
+	uint64_t sk[3][16];
+
+	bs_subkeys(k1, sk[0]);
+	bs_subkeys(k2, sk[1]);
+	bs_subkeys(k3, sk[2]);
+	for( ; blocks >= BS_LANES; blocks -= BS_LANES )
+	{
+		bs_block(data, sk, 3);
+		data += BS_LANES * 8;
+	}
+}
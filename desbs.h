@@ -0,0 +1,41 @@
+/*
+ * desbs.h - Bitsliced DES engine for the DES Test Program
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __DESBS_H__
+#define __DESBS_H__
+
+#include <stdint.h>
+
+#define DES_BS_LANES	64	/* Blocks per pass of the scalar kernel */
+#define DES_BS_THRESHOLD DES_BS_LANES	/* Default switch-over, in blocks */
+
+/* One entry per DES kernel. lanes is the number of blocks the bulk
+ * functions take per pass, 0 for the table-only kernel (which has no
+ * bulk functions). supported() says whether this CPU can run it.
+ */
+typedef struct {
+	const char *name;
+	int lanes;
+	void (*ecb)(uint32_t *, unsigned char *, int);
+	void (*ecb3)(uint32_t *, uint32_t *, uint32_t *, unsigned char *, int);
+	int (*supported)(void);
+} des_kernel;
+
+/* Bitsliced kernels, one per word width (desbs.c built per ISA) */
+void des_bs_ecb_scalar(uint32_t *, unsigned char *, int);
+void des_bs_ecb3_scalar(uint32_t *, uint32_t *, uint32_t *, unsigned char *, int);
+#ifdef DES_X86_KERNELS
+void des_bs_ecb_sse2(uint32_t *, unsigned char *, int);
+void des_bs_ecb3_sse2(uint32_t *, uint32_t *, uint32_t *, unsigned char *, int);
+void des_bs_ecb_avx2(uint32_t *, unsigned char *, int);
+void des_bs_ecb3_avx2(uint32_t *, uint32_t *, uint32_t *, unsigned char *, int);
+void des_bs_ecb_avx512(uint32_t *, unsigned char *, int);
+void des_bs_ecb3_avx512(uint32_t *, uint32_t *, uint32_t *, unsigned char *, int);
+#endif
+
+#endif	// __DESBS_H__
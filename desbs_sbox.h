@@ -0,0 +1,601 @@
+/*
+ * desbs_sbox.h - Boolean circuits for the eight DES S-boxes, for the
+ * bitsliced engine in desbs.c. Generated from the S-box tables in
+ * FIPS 46-3: each S-box row is a 4-input function of the middle input
+ * bits (x1..x4), built as a shared multiplexer tree, and the row is then
+ * chosen by the outer bits (x0,x5). Outputs are XORed into o0..o3
+ * (o0 is the most significant S-box output bit).
+ *
+ * BSW is the bitslice word type, defined by the includer.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ */
+
+#ifndef __DESBS_SBOX_H__
+#define __DESBS_SBOX_H__
+
+static inline void s1(BSW x0, BSW x1, BSW x2, BSW x3, BSW x4, BSW x5,
+	BSW *o0, BSW *o1, BSW *o2, BSW *o3)
+{
+	BSW t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+	    t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+	    t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41,
+	    t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54,
+	    t55, t56, t57, t58, t59, t60, t61, t62;
+
+	t1 = ~x4;
+	t2 = x4 | x3;
+	t3 = t1 ^ ((t1 ^ t2) & x2);
+	t4 = x4 & ~x3;
+	t5 = x4 ^ ((x4 ^ t4) & x2);
+	t6 = t3 ^ ((t3 ^ t5) & x1);
+	t7 = t4 ^ ((t4 ^ t1) & x2);
+	t8 = ~t4;
+	t9 = t1 ^ x3;
+	t10 = t8 ^ ((t8 ^ t9) & x2);
+	t11 = t7 ^ ((t7 ^ t10) & x1);
+	t12 = x3 ^ ((x3 ^ t9) & x2);
+	t13 = t1 | ~x3;
+	t14 = t13 ^ ((t13 ^ t4) & x2);
+	t15 = t12 ^ ((t12 ^ t14) & x1);
+	t16 = x4 ^ ((x4 ^ t9) & x2);
+	t17 = t14 ^ ((t14 ^ t16) & x1);
+	t18 = t14 ^ ((t14 ^ t12) & x1);
+	t19 = t2 ^ ((t2 ^ t1) & x2);
+	t20 = ~t9;
+	t21 = t20 ^ ((t20 ^ t4) & x2);
+	t22 = t19 ^ ((t19 ^ t21) & x1);
+	t23 = ~x3;
+	t24 = t1 ^ ((t1 ^ t23) & x2);
+	t25 = x4 | ~x3;
+	t26 = ~t25;
+	t27 = t25 ^ x2;
+	t28 = t24 ^ ((t24 ^ t27) & x1);
+	t29 = t23 ^ ((t23 ^ t9) & x2);
+	t30 = t9 ^ ((t9 ^ x3) & x2);
+	t31 = t29 ^ ((t29 ^ t30) & x1);
+	t32 = ~t2;
+	t33 = t32 ^ ((t32 ^ t13) & x2);
+	t34 = ~t13;
+	t35 = t13 ^ x2;
+	t36 = t33 ^ ((t33 ^ t35) & x1);
+	t37 = ~t30;
+	t38 = t37 ^ ((t37 ^ t27) & x1);
+	t39 = t26 ^ ((t26 ^ t2) & x2);
+	t40 = t9 ^ ((t9 ^ t23) & x2);
+	t41 = t39 ^ ((t39 ^ t40) & x1);
+	t42 = t9 ^ ((t9 ^ t34) & x2);
+	t43 = t42 ^ ((t42 ^ t19) & x1);
+	t44 = ~t29;
+	t45 = t32 ^ ((t32 ^ t25) & x2);
+	t46 = t44 ^ ((t44 ^ t45) & x1);
+	t47 = ~t40;
+	t48 = ~t35;
+	t49 = t47 ^ ((t47 ^ t48) & x1);
+	t50 = t4 ^ ((t4 ^ t9) & x2);
+	t51 = t8 ^ ((t8 ^ t1) & x2);
+	t52 = t50 ^ ((t50 ^ t51) & x1);
+	t53 = t32 ^ x2;
+	t54 = t53 ^ ((t53 ^ t35) & x1);
+	t55 = t6 ^ ((t6 ^ t11) & x5);
+	t56 = t15 ^ ((t15 ^ t17) & x5);
+	*o0 ^= t55 ^ ((t55 ^ t56) & x0);
+	t57 = t18 ^ ((t18 ^ t22) & x5);
+	t58 = t28 ^ ((t28 ^ t31) & x5);
+	*o1 ^= t57 ^ ((t57 ^ t58) & x0);
+	t59 = t36 ^ ((t36 ^ t38) & x5);
+	t60 = t41 ^ ((t41 ^ t43) & x5);
+	*o2 ^= t59 ^ ((t59 ^ t60) & x0);
+	t61 = t46 ^ ((t46 ^ t49) & x5);
+	t62 = t52 ^ ((t52 ^ t54) & x5);
+	*o3 ^= t61 ^ ((t61 ^ t62) & x0);
+}
+
+static inline void s2(BSW x0, BSW x1, BSW x2, BSW x3, BSW x4, BSW x5,
+	BSW *o0, BSW *o1, BSW *o2, BSW *o3)
+{
+	BSW t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+	    t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+	    t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41,
+	    t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54,
+	    t55, t56, t57, t58, t59;
+
+	t1 = ~x4;
+	t2 = t1 | x3;
+	t3 = ~t2;
+	t4 = t2 ^ x2;
+	t5 = t1 ^ x3;
+	t6 = t4 ^ ((t4 ^ t5) & x1);
+	t7 = ~t4;
+	t8 = ~t5;
+	t9 = t5 ^ x2;
+	t10 = t7 ^ ((t7 ^ t9) & x1);
+	t11 = x4 ^ x2;
+	t12 = ~t9;
+	t13 = t11 ^ ((t11 ^ t12) & x1);
+	t14 = t1 | ~x3;
+	t15 = t14 ^ ((t14 ^ t3) & x2);
+	t16 = t5 ^ ((t5 ^ x3) & x2);
+	t17 = t15 ^ ((t15 ^ t16) & x1);
+	t18 = t5 ^ ((t5 ^ t11) & x1);
+	t19 = x4 | x3;
+	t20 = t19 ^ ((t19 ^ t5) & x2);
+	t21 = ~t19;
+	t22 = t21 ^ ((t21 ^ t5) & x2);
+	t23 = t20 ^ ((t20 ^ t22) & x1);
+	t24 = ~t14;
+	t25 = t2 ^ ((t2 ^ t24) & x2);
+	t26 = t8 ^ ((t8 ^ t25) & x1);
+	t27 = ~t23;
+	t28 = t5 ^ ((t5 ^ t14) & x2);
+	t29 = t28 ^ x1;
+	t30 = x4 | ~x3;
+	t31 = t5 ^ ((t5 ^ t30) & x2);
+	t32 = t24 ^ ((t24 ^ t1) & x2);
+	t33 = t31 ^ ((t31 ^ t32) & x1);
+	t34 = t19 ^ x2;
+	t35 = t24 ^ ((t24 ^ t19) & x2);
+	t36 = t34 ^ ((t34 ^ t35) & x1);
+	t37 = ~t30;
+	t38 = t37 ^ x2;
+	t39 = t14 ^ ((t14 ^ t37) & x2);
+	t40 = t38 ^ ((t38 ^ t39) & x1);
+	t41 = ~x3;
+	t42 = t41 ^ ((t41 ^ t8) & x2);
+	t43 = ~t38;
+	t44 = t42 ^ ((t42 ^ t43) & x1);
+	t45 = t30 ^ ((t30 ^ t21) & x2);
+	t46 = t45 ^ x1;
+	t47 = t21 ^ ((t21 ^ t30) & x2);
+	t48 = x3 ^ ((x3 ^ t47) & x1);
+	t49 = t5 ^ ((t5 ^ t41) & x2);
+	t50 = ~t11;
+	t51 = t49 ^ ((t49 ^ t50) & x1);
+	t52 = t6 ^ ((t6 ^ t10) & x5);
+	t53 = t13 ^ ((t13 ^ t17) & x5);
+	*o0 ^= t52 ^ ((t52 ^ t53) & x0);
+	t54 = t18 ^ ((t18 ^ t23) & x5);
+	t55 = t26 ^ ((t26 ^ t27) & x5);
+	*o1 ^= t54 ^ ((t54 ^ t55) & x0);
+	t56 = t29 ^ ((t29 ^ t33) & x5);
+	t57 = t36 ^ ((t36 ^ t40) & x5);
+	*o2 ^= t56 ^ ((t56 ^ t57) & x0);
+	t58 = t44 ^ ((t44 ^ t46) & x5);
+	t59 = t48 ^ ((t48 ^ t51) & x5);
+	*o3 ^= t58 ^ ((t58 ^ t59) & x0);
+}
+
+static inline void s3(BSW x0, BSW x1, BSW x2, BSW x3, BSW x4, BSW x5,
+	BSW *o0, BSW *o1, BSW *o2, BSW *o3)
+{
+	BSW t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+	    t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+	    t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41,
+	    t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54,
+	    t55, t56, t57, t58;
+
+	t1 = ~x4;
+	t2 = t1 | x3;
+	t3 = t1 & x3;
+	t4 = t2 ^ ((t2 ^ t3) & x2);
+	t5 = x4 ^ x3;
+	t6 = ~t5;
+	t7 = t5 ^ x2;
+	t8 = t4 ^ ((t4 ^ t7) & x1);
+	t9 = x4 & x3;
+	t10 = t6 ^ ((t6 ^ t9) & x2);
+	t11 = ~t9;
+	t12 = x4 ^ ((x4 ^ t11) & x2);
+	t13 = t10 ^ ((t10 ^ t12) & x1);
+	t14 = ~x3;
+	t15 = t6 ^ ((t6 ^ t14) & x2);
+	t16 = ~t7;
+	t17 = t15 ^ ((t15 ^ t16) & x1);
+	t18 = t5 ^ ((t5 ^ t7) & x1);
+	t19 = t9 ^ ((t9 ^ t2) & x2);
+	t20 = x4 | x3;
+	t21 = ~t2;
+	t22 = t20 ^ ((t20 ^ t21) & x2);
+	t23 = t19 ^ ((t19 ^ t22) & x1);
+	t24 = t14 ^ ((t14 ^ t5) & x2);
+	t25 = x3 ^ ((x3 ^ t1) & x2);
+	t26 = t24 ^ ((t24 ^ t25) & x1);
+	t27 = ~t19;
+	t28 = t27 ^ x1;
+	t29 = t3 ^ ((t3 ^ t6) & x2);
+	t30 = t11 ^ ((t11 ^ x4) & x2);
+	t31 = t29 ^ ((t29 ^ t30) & x1);
+	t32 = t6 ^ ((t6 ^ t11) & x2);
+	t33 = ~t30;
+	t34 = t32 ^ ((t32 ^ t33) & x1);
+	t35 = t21 ^ x2;
+	t36 = t35 ^ ((t35 ^ t16) & x1);
+	t37 = t21 ^ ((t21 ^ t5) & x2);
+	t38 = t1 ^ ((t1 ^ t20) & x2);
+	t39 = t37 ^ ((t37 ^ t38) & x1);
+	t40 = t21 ^ ((t21 ^ t6) & x2);
+	t41 = t20 ^ ((t20 ^ t1) & x2);
+	t42 = t40 ^ ((t40 ^ t41) & x1);
+	t43 = t3 ^ ((t3 ^ t20) & x2);
+	t44 = t43 ^ x1;
+	t45 = ~t44;
+	t46 = t14 ^ ((t14 ^ t6) & x2);
+	t47 = t16 ^ ((t16 ^ t46) & x1);
+	t48 = t1 ^ x2;
+	t49 = x4 ^ ((x4 ^ t14) & x2);
+	t50 = t48 ^ ((t48 ^ t49) & x1);
+	t51 = t8 ^ ((t8 ^ t13) & x5);
+	t52 = t17 ^ ((t17 ^ t18) & x5);
+	*o0 ^= t51 ^ ((t51 ^ t52) & x0);
+	t53 = t23 ^ ((t23 ^ t26) & x5);
+	t54 = t28 ^ ((t28 ^ t31) & x5);
+	*o1 ^= t53 ^ ((t53 ^ t54) & x0);
+	t55 = t34 ^ ((t34 ^ t36) & x5);
+	t56 = t39 ^ ((t39 ^ t42) & x5);
+	*o2 ^= t55 ^ ((t55 ^ t56) & x0);
+	t57 = t44 ^ ((t44 ^ t45) & x5);
+	t58 = t47 ^ ((t47 ^ t50) & x5);
+	*o3 ^= t57 ^ ((t57 ^ t58) & x0);
+}
+
+static inline void s4(BSW x0, BSW x1, BSW x2, BSW x3, BSW x4, BSW x5,
+	BSW *o0, BSW *o1, BSW *o2, BSW *o3)
+{
+	BSW t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+	    t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+	    t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41,
+	    t42, t43, t44;
+
+	t1 = ~x4;
+	t2 = x4 ^ x3;
+	t3 = t2 ^ ((t2 ^ x3) & x2);
+	t4 = t1 & x3;
+	t5 = ~t4;
+	t6 = t4 ^ x2;
+	t7 = t3 ^ ((t3 ^ t6) & x1);
+	t8 = t1 | ~x3;
+	t9 = x4 & ~x3;
+	t10 = t8 ^ ((t8 ^ t9) & x2);
+	t11 = ~t8;
+	t12 = x4 | x3;
+	t13 = t11 ^ ((t11 ^ t12) & x2);
+	t14 = t10 ^ ((t10 ^ t13) & x1);
+	t15 = t1 ^ ((t1 ^ t5) & x2);
+	t16 = ~t2;
+	t17 = t16 ^ ((t16 ^ t4) & x2);
+	t18 = t15 ^ ((t15 ^ t17) & x1);
+	t19 = ~t9;
+	t20 = t9 ^ x2;
+	t21 = t20 ^ ((t20 ^ t16) & x1);
+	t22 = ~t7;
+	t23 = ~t18;
+	t24 = t19 ^ ((t19 ^ x4) & x2);
+	t25 = t9 ^ ((t9 ^ t16) & x2);
+	t26 = t24 ^ ((t24 ^ t25) & x1);
+	t27 = t6 ^ ((t6 ^ t2) & x1);
+	t28 = ~x3;
+	t29 = t28 ^ ((t28 ^ t2) & x2);
+	t30 = ~t20;
+	t31 = t29 ^ ((t29 ^ t30) & x1);
+	t32 = ~t12;
+	t33 = t5 ^ ((t5 ^ t32) & x2);
+	t34 = t33 ^ ((t33 ^ t13) & x1);
+	t35 = ~t27;
+	t36 = ~t34;
+	t37 = t7 ^ ((t7 ^ t14) & x5);
+	t38 = t18 ^ ((t18 ^ t21) & x5);
+	*o0 ^= t37 ^ ((t37 ^ t38) & x0);
+	t39 = t14 ^ ((t14 ^ t22) & x5);
+	t40 = t21 ^ ((t21 ^ t23) & x5);
+	*o1 ^= t39 ^ ((t39 ^ t40) & x0);
+	t41 = t26 ^ ((t26 ^ t27) & x5);
+	t42 = t31 ^ ((t31 ^ t34) & x5);
+	*o2 ^= t41 ^ ((t41 ^ t42) & x0);
+	t43 = t35 ^ ((t35 ^ t26) & x5);
+	t44 = t36 ^ ((t36 ^ t31) & x5);
+	*o3 ^= t43 ^ ((t43 ^ t44) & x0);
+}
+
+static inline void s5(BSW x0, BSW x1, BSW x2, BSW x3, BSW x4, BSW x5,
+	BSW *o0, BSW *o1, BSW *o2, BSW *o3)
+{
+	BSW t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+	    t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+	    t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41,
+	    t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54,
+	    t55, t56, t57, t58, t59, t60, t61, t62, t63, t64, t65;
+
+	t1 = x4 & ~x3;
+	t2 = ~x4;
+	t3 = x4 ^ x3;
+	t4 = t1 ^ ((t1 ^ t3) & x2);
+	t5 = ~t3;
+	t6 = ~t1;
+	t7 = t5 ^ ((t5 ^ t6) & x2);
+	t8 = t4 ^ ((t4 ^ t7) & x1);
+	t9 = x4 | ~x3;
+	t10 = ~t9;
+	t11 = t9 ^ x2;
+	t12 = x3 ^ ((x3 ^ t3) & x2);
+	t13 = t11 ^ ((t11 ^ t12) & x1);
+	t14 = x4 & x3;
+	t15 = t14 ^ ((t14 ^ t9) & x2);
+	t16 = ~t14;
+	t17 = t16 ^ x2;
+	t18 = t15 ^ ((t15 ^ t17) & x1);
+	t19 = t16 ^ ((t16 ^ x4) & x2);
+	t20 = t2 & ~x3;
+	t21 = x4 ^ ((x4 ^ t20) & x2);
+	t22 = t19 ^ ((t19 ^ t21) & x1);
+	t23 = t3 ^ x2;
+	t24 = x4 ^ x2;
+	t25 = t23 ^ ((t23 ^ t24) & x1);
+	t26 = t5 ^ ((t5 ^ t16) & x2);
+	t27 = t2 ^ ((t2 ^ t14) & x2);
+	t28 = t26 ^ ((t26 ^ t27) & x1);
+	t29 = t20 ^ ((t20 ^ t3) & x2);
+	t30 = ~t4;
+	t31 = t29 ^ ((t29 ^ t30) & x1);
+	t32 = x3 ^ ((x3 ^ x4) & x2);
+	t33 = ~x3;
+	t34 = t33 ^ ((t33 ^ t3) & x2);
+	t35 = t32 ^ ((t32 ^ t34) & x1);
+	t36 = t20 | x2;
+	t37 = x3 ^ ((x3 ^ t10) & x2);
+	t38 = t36 ^ ((t36 ^ t37) & x1);
+	t39 = t16 ^ ((t16 ^ t1) & x2);
+	t40 = ~t34;
+	t41 = t39 ^ ((t39 ^ t40) & x1);
+	t42 = t20 ^ ((t20 ^ t9) & x2);
+	t43 = t24 ^ ((t24 ^ t42) & x1);
+	t44 = ~t23;
+	t45 = ~t12;
+	t46 = t44 ^ ((t44 ^ t45) & x1);
+	t47 = ~t19;
+	t48 = ~t29;
+	t49 = t47 ^ ((t47 ^ t48) & x1);
+	t50 = ~t20;
+	t51 = t1 ^ ((t1 ^ t50) & x2);
+	t52 = t2 ^ ((t2 ^ t33) & x2);
+	t53 = t51 ^ ((t51 ^ t52) & x1);
+	t54 = t9 ^ ((t9 ^ t1) & x2);
+	t55 = t12 ^ ((t12 ^ t54) & x1);
+	t56 = ~t52;
+	t57 = t5 ^ ((t5 ^ t56) & x1);
+	t58 = t8 ^ ((t8 ^ t13) & x5);
+	t59 = t18 ^ ((t18 ^ t22) & x5);
+	*o0 ^= t58 ^ ((t58 ^ t59) & x0);
+	t60 = t25 ^ ((t25 ^ t28) & x5);
+	t61 = t31 ^ ((t31 ^ t35) & x5);
+	*o1 ^= t60 ^ ((t60 ^ t61) & x0);
+	t62 = t38 ^ ((t38 ^ t41) & x5);
+	t63 = t43 ^ ((t43 ^ t46) & x5);
+	*o2 ^= t62 ^ ((t62 ^ t63) & x0);
+	t64 = t49 ^ ((t49 ^ t53) & x5);
+	t65 = t55 ^ ((t55 ^ t57) & x5);
+	*o3 ^= t64 ^ ((t64 ^ t65) & x0);
+}
+
+static inline void s6(BSW x0, BSW x1, BSW x2, BSW x3, BSW x4, BSW x5,
+	BSW *o0, BSW *o1, BSW *o2, BSW *o3)
+{
+	BSW t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+	    t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+	    t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41,
+	    t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54,
+	    t55, t56, t57, t58, t59, t60, t61, t62, t63, t64;
+
+	t1 = ~x4;
+	t2 = t1 | x3;
+	t3 = t1 ^ x3;
+	t4 = t2 ^ ((t2 ^ t3) & x2);
+	t5 = ~t2;
+	t6 = t5 ^ ((t5 ^ t3) & x2);
+	t7 = t4 ^ ((t4 ^ t6) & x1);
+	t8 = ~x3;
+	t9 = ~t3;
+	t10 = t8 ^ ((t8 ^ t9) & x2);
+	t11 = x3 ^ ((x3 ^ x4) & x2);
+	t12 = t10 ^ ((t10 ^ t11) & x1);
+	t13 = t1 | ~x3;
+	t14 = t13 ^ ((t13 ^ t9) & x2);
+	t15 = ~t13;
+	t16 = t15 ^ ((t15 ^ t9) & x2);
+	t17 = t14 ^ ((t14 ^ t16) & x1);
+	t18 = t15 ^ ((t15 ^ t2) & x2);
+	t19 = t8 ^ x2;
+	t20 = t18 ^ ((t18 ^ t19) & x1);
+	t21 = t1 & x3;
+	t22 = t3 ^ ((t3 ^ t21) & x2);
+	t23 = x4 ^ ((x4 ^ t13) & x2);
+	t24 = t22 ^ ((t22 ^ t23) & x1);
+	t25 = ~t22;
+	t26 = t2 & ~x2;
+	t27 = t25 ^ ((t25 ^ t26) & x1);
+	t28 = x4 | x3;
+	t29 = t28 ^ ((t28 ^ t21) & x2);
+	t30 = t1 ^ x2;
+	t31 = t29 ^ ((t29 ^ t30) & x1);
+	t32 = t3 ^ x2;
+	t33 = x4 ^ ((x4 ^ t3) & x2);
+	t34 = t32 ^ ((t32 ^ t33) & x1);
+	t35 = x3 ^ ((x3 ^ t9) & x2);
+	t36 = ~t21;
+	t37 = t21 ^ x2;
+	t38 = t35 ^ ((t35 ^ t37) & x1);
+	t39 = ~t28;
+	t40 = t36 ^ ((t36 ^ t39) & x2);
+	t41 = t40 ^ ((t40 ^ t32) & x1);
+	t42 = ~t32;
+	t43 = t3 ^ ((t3 ^ x3) & x2);
+	t44 = t42 ^ ((t42 ^ t43) & x1);
+	t45 = t9 ^ ((t9 ^ x3) & x2);
+	t46 = t45 ^ ((t45 ^ t40) & x1);
+	t47 = x4 ^ ((x4 ^ t39) & x2);
+	t48 = t9 ^ ((t9 ^ t28) & x2);
+	t49 = t47 ^ ((t47 ^ t48) & x1);
+	t50 = t5 ^ x2;
+	t51 = t50 ^ ((t50 ^ t9) & x1);
+	t52 = t2 ^ ((t2 ^ t15) & x2);
+	t53 = t39 ^ ((t39 ^ t13) & x2);
+	t54 = t52 ^ ((t52 ^ t53) & x1);
+	t55 = ~t52;
+	t56 = t55 ^ x1;
+	t57 = t7 ^ ((t7 ^ t12) & x5);
+	t58 = t17 ^ ((t17 ^ t20) & x5);
+	*o0 ^= t57 ^ ((t57 ^ t58) & x0);
+	t59 = t24 ^ ((t24 ^ t27) & x5);
+	t60 = t31 ^ ((t31 ^ t34) & x5);
+	*o1 ^= t59 ^ ((t59 ^ t60) & x0);
+	t61 = t38 ^ ((t38 ^ t41) & x5);
+	t62 = t44 ^ ((t44 ^ t46) & x5);
+	*o2 ^= t61 ^ ((t61 ^ t62) & x0);
+	t63 = t49 ^ ((t49 ^ t51) & x5);
+	t64 = t54 ^ ((t54 ^ t56) & x5);
+	*o3 ^= t63 ^ ((t63 ^ t64) & x0);
+}
+
+static inline void s7(BSW x0, BSW x1, BSW x2, BSW x3, BSW x4, BSW x5,
+	BSW *o0, BSW *o1, BSW *o2, BSW *o3)
+{
+	BSW t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+	    t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+	    t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41,
+	    t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54,
+	    t55, t56, t57;
+
+	t1 = ~x4;
+	t2 = t1 | x3;
+	t3 = x4 ^ ((x4 ^ t2) & x2);
+	t4 = x4 ^ x3;
+	t5 = ~t2;
+	t6 = t4 ^ ((t4 ^ t5) & x2);
+	t7 = t3 ^ ((t3 ^ t6) & x1);
+	t8 = t1 ^ x2;
+	t9 = ~t4;
+	t10 = t9 ^ x2;
+	t11 = t8 ^ ((t8 ^ t10) & x1);
+	t12 = x3 ^ ((x3 ^ t9) & x2);
+	t13 = x4 | ~x3;
+	t14 = ~t13;
+	t15 = t13 ^ x2;
+	t16 = t12 ^ ((t12 ^ t15) & x1);
+	t17 = x4 | x3;
+	t18 = t17 ^ ((t17 ^ t14) & x2);
+	t19 = t18 ^ ((t18 ^ t9) & x1);
+	t20 = ~t8;
+	t21 = t9 ^ ((t9 ^ t20) & x1);
+	t22 = ~t17;
+	t23 = t9 ^ ((t9 ^ t22) & x2);
+	t24 = t2 ^ ((t2 ^ x4) & x2);
+	t25 = t23 ^ ((t23 ^ t24) & x1);
+	t26 = x4 ^ ((x4 ^ t9) & x2);
+	t27 = t8 ^ ((t8 ^ t26) & x1);
+	t28 = t17 ^ x2;
+	t29 = t28 ^ ((t28 ^ t10) & x1);
+	t30 = x4 & x3;
+	t31 = x3 ^ ((x3 ^ t30) & x2);
+	t32 = ~x3;
+	t33 = t32 ^ ((t32 ^ t13) & x2);
+	t34 = t31 ^ ((t31 ^ t33) & x1);
+	t35 = t14 ^ ((t14 ^ t17) & x2);
+	t36 = ~t30;
+	t37 = t36 ^ x2;
+	t38 = t35 ^ ((t35 ^ t37) & x1);
+	t39 = t32 ^ x2;
+	t40 = ~t37;
+	t41 = t39 ^ ((t39 ^ t40) & x1);
+	t42 = t5 ^ ((t5 ^ t9) & x2);
+	t43 = t2 ^ ((t2 ^ t9) & x2);
+	t44 = t42 ^ ((t42 ^ t43) & x1);
+	t45 = ~t42;
+	t46 = t45 ^ ((t45 ^ t6) & x1);
+	t47 = ~t44;
+	t48 = ~t10;
+	t49 = t48 ^ ((t48 ^ t15) & x1);
+	t50 = t7 ^ ((t7 ^ t11) & x5);
+	t51 = t16 ^ ((t16 ^ t19) & x5);
+	*o0 ^= t50 ^ ((t50 ^ t51) & x0);
+	t52 = t21 ^ ((t21 ^ t25) & x5);
+	t53 = t7 ^ ((t7 ^ t27) & x5);
+	*o1 ^= t52 ^ ((t52 ^ t53) & x0);
+	t54 = t29 ^ ((t29 ^ t34) & x5);
+	t55 = t38 ^ ((t38 ^ t41) & x5);
+	*o2 ^= t54 ^ ((t54 ^ t55) & x0);
+	t56 = t44 ^ ((t44 ^ t46) & x5);
+	t57 = t47 ^ ((t47 ^ t49) & x5);
+	*o3 ^= t56 ^ ((t56 ^ t57) & x0);
+}
+
+static inline void s8(BSW x0, BSW x1, BSW x2, BSW x3, BSW x4, BSW x5,
+	BSW *o0, BSW *o1, BSW *o2, BSW *o3)
+{
+	BSW t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14, t15,
+	    t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+	    t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41,
+	    t42, t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54,
+	    t55, t56;
+
+	t1 = ~x4;
+	t2 = x4 ^ x3;
+	t3 = t1 ^ ((t1 ^ t2) & x2);
+	t4 = x4 | ~x3;
+	t5 = ~t4;
+	t6 = t4 ^ x2;
+	t7 = t3 ^ ((t3 ^ t6) & x1);
+	t8 = x4 | x3;
+	t9 = ~t8;
+	t10 = t8 ^ x2;
+	t11 = ~t2;
+	t12 = t11 ^ x2;
+	t13 = t10 ^ ((t10 ^ t12) & x1);
+	t14 = x4 & ~x3;
+	t15 = t1 | ~x3;
+	t16 = t14 ^ ((t14 ^ t15) & x2);
+	t17 = x3 ^ ((x3 ^ t11) & x2);
+	t18 = t16 ^ ((t16 ^ t17) & x1);
+	t19 = t5 ^ ((t5 ^ t8) & x2);
+	t20 = ~t15;
+	t21 = t15 ^ x2;
+	t22 = t19 ^ ((t19 ^ t21) & x1);
+	t23 = ~x3;
+	t24 = t11 ^ ((t11 ^ t23) & x2);
+	t25 = ~t14;
+	t26 = t20 ^ ((t20 ^ t25) & x2);
+	t27 = t24 ^ ((t24 ^ t26) & x1);
+	t28 = ~t27;
+	t29 = x4 ^ x2;
+	t30 = t3 ^ ((t3 ^ t29) & x1);
+	t31 = t17 ^ x1;
+	t32 = t16 ^ x1;
+	t33 = x3 ^ ((x3 ^ x4) & x2);
+	t34 = t16 ^ ((t16 ^ t33) & x1);
+	t35 = t23 ^ x2;
+	t36 = t2 ^ ((t2 ^ t23) & x2);
+	t37 = t35 ^ ((t35 ^ t36) & x1);
+	t38 = t25 ^ x2;
+	t39 = t9 ^ ((t9 ^ t25) & x2);
+	t40 = t38 ^ ((t38 ^ t39) & x1);
+	t41 = ~t13;
+	t42 = t15 ^ ((t15 ^ t2) & x2);
+	t43 = x4 ^ ((x4 ^ t5) & x2);
+	t44 = t42 ^ ((t42 ^ t43) & x1);
+	t45 = ~t22;
+	t46 = x4 ^ ((x4 ^ t20) & x2);
+	t47 = ~t43;
+	t48 = t46 ^ ((t46 ^ t47) & x1);
+	t49 = t7 ^ ((t7 ^ t13) & x5);
+	t50 = t18 ^ ((t18 ^ t22) & x5);
+	*o0 ^= t49 ^ ((t49 ^ t50) & x0);
+	t51 = t27 ^ ((t27 ^ t28) & x5);
+	t52 = t30 ^ ((t30 ^ t31) & x5);
+	*o1 ^= t51 ^ ((t51 ^ t52) & x0);
+	t53 = t32 ^ ((t32 ^ t34) & x5);
+	t54 = t37 ^ ((t37 ^ t40) & x5);
+	*o2 ^= t53 ^ ((t53 ^ t54) & x0);
+	t55 = t41 ^ ((t41 ^ t44) & x5);
+	t56 = t45 ^ ((t45 ^ t48) & x5);
+	*o3 ^= t55 ^ ((t55 ^ t56) & x0);
+}
+
+#endif	// __DESBS_SBOX_H__
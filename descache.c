@@ -0,0 +1,216 @@
+/*
+ * descache.c - Key schedule cache for the DES Test Program
+ *
+ * A des_cache maps raw key bytes (8 for single DES, 16 or 24 for Triple
+ * DES) to a ready des_ctx or des3_ctx. A hit hands back the cached schedule
+ * without running deskey()/cookey() again; a miss builds it in the
+ * least recently used slot. Lookups hash the key into chained buckets,
+ * and every entry sits on one LRU list, most recent first.
+ *
+ * A schedule returned by the cache stays valid until the next call on
+ * the same cache, which may evict it. A cache is not locked; give each
+ * thread its own.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#define _DEFAULT_SOURCE		/* explicit_bzero() */
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "desutils.h"
+#include "descache.h"
+
+#define CACHE_KEYMAX	24	/* Longest key the cache takes */
+
+typedef struct cache_ent {
+	union {
+		des_ctx dc;
+		des3_ctx d3;
+	} ctx;
+	unsigned char key[CACHE_KEYMAX];
+	int len;			/* Key bytes, 8, 16 or 24 */
+	struct cache_ent *chain;	/* Next in this hash bucket */
+	struct cache_ent *newer;	/* LRU list neighbours */
+	struct cache_ent *older;
+} cache_ent;
+
+struct des_cache {
+	cache_ent *ents;		/* size slots, used of them filled */
+	int size;
+	int used;
+	cache_ent **bucket;		/* mask + 1 chain heads */
+	uint32_t mask;
+	cache_ent *newest;
+	cache_ent *oldest;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+};
+
+/* Hash of len key bytes, taken 8 at a time with a multiply and fold */
+static uint32_t cache_hash(unsigned char *key, int len)
+{
+	uint64_t h, w;
+	register int i;
+
+	h = len;
+	for( i = 0; i < len; i += 8 )
+	{
+		memcpy(&w, key + i, 8);
+		h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	return (uint32_t)(h ^ (h >> 32));
+}
+
+static void lru_unlink(des_cache *c, cache_ent *e)
+{
+	if( e->newer != NULL )
+		e->newer->older = e->older;
+	else
+		c->newest = e->older;
+	if( e->older != NULL )
+		e->older->newer = e->newer;
+	else
+		c->oldest = e->newer;
+}
+
+static void lru_push(des_cache *c, cache_ent *e)
+{
+	e->newer = NULL;
+	e->older = c->newest;
+	if( c->newest != NULL )
+		c->newest->newer = e;
+	else
+		c->oldest = e;
+	c->newest = e;
+}
+
+/* Find key in the cache. On a miss, claim a slot for it (evicting the
+   oldest entry if full) and return it with *hit clear; the caller then
+   builds the schedule. */
+static cache_ent *cache_find(des_cache *c, unsigned char *key, int len, int *hit)
+{
+	cache_ent *e, **pp;
+	uint32_t h;
+
+	h = cache_hash(key, len) & c->mask;
+	for( e = c->bucket[h]; e != NULL; e = e->chain )
+	{
+		if( e->len == len && memcmp(e->key, key, len) == 0 )
+		{
+			c->hits++;
+			if( c->newest != e )
+			{
+				lru_unlink(c, e);
+				lru_push(c, e);
+			}
+			*hit = 1;
+			return e;
+		}
+	}
+
+	c->misses++;
+	if( c->used < c->size )
+		e = &c->ents[c->used++];
+	else
+	{
+		e = c->oldest;
+		lru_unlink(c, e);
+		pp = &c->bucket[cache_hash(e->key, e->len) & c->mask];
+		while( *pp != e )
+			pp = &(*pp)->chain;
+		*pp = e->chain;
+		c->evictions++;
+	}
+
+	memcpy(e->key, key, len);
+	e->len = len;
+	e->chain = c->bucket[h];
+	c->bucket[h] = e;
+	lru_push(c, e);
+	*hit = 0;
+	return e;
+}
+
+/* A cache holding up to size schedules, NULL if out of memory */
+des_cache *des_cache_create(int size)
+{
+	des_cache *c;
+	void *p;
+	uint32_t n;
+
+	if( size < 1 )
+		size = 1;
+	c = calloc(1, sizeof(*c));
+	if( c == NULL )
+		return NULL;
+
+	/* At least two buckets per entry keeps the chains short */
+	for( n = 2; n < (uint32_t)size * 2; n <<= 1 )
+		;
+	c->size = size;
+	c->mask = n - 1;
+	c->bucket = calloc(n, sizeof(*c->bucket));
+	if( c->bucket == NULL ||
+	    posix_memalign(&p, 64, (size_t)size * sizeof(cache_ent)) != 0 )
+	{
+		free(c->bucket);
+		free(c);
+		return NULL;
+	}
+	c->ents = p;
+	return c;
+}
+
+void des_cache_destroy(des_cache *c)
+{
+	if( c == NULL )
+		return;
+	/* Schedules are key material; don't leave them in freed memory.
+	   A memset() this close to free() may be optimised away. */
+	explicit_bzero(c->ents, (size_t)c->size * sizeof(cache_ent));
+	free(c->ents);
+	free(c->bucket);
+	free(c);
+}
+
+/* Single DES schedule for the 8 byte key */
+des_ctx *des_cache_key(des_cache *c, unsigned char *key)
+{
+	cache_ent *e;
+	int hit;
+
+	e = cache_find(c, key, 8, &hit);
+	if( !hit )
+		des_key(&e->ctx.dc, key);
+	return &e->ctx.dc;
+}
+
+/* Triple DES schedule for the len byte key, two keys (16) or three
+   (24); NULL for any other length */
+des3_ctx *des3_cache_key(des_cache *c, unsigned char *key, int len)
+{
+	cache_ent *e;
+	int hit;
+
+	if( len != 16 && len != 24 )
+		return NULL;
+	e = cache_find(c, key, len, &hit);
+	if( !hit && len == 24 )
+		des3_key3(&e->ctx.d3, key);
+	else if( !hit )
+		des3_key(&e->ctx.d3, key);
+	return &e->ctx.d3;
+}
+
+void des_cache_get_stats(des_cache *c, des_cache_stats *st)
+{
+	st->hits = c->hits;
+	st->misses = c->misses;
+	st->evictions = c->evictions;
+	st->entries = c->used;
+	st->size = c->size;
+}
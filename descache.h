@@ -0,0 +1,33 @@
+/*
+ * descache.h - Key schedule cache for the DES Test Program
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __DESCACHE_H__
+#define __DESCACHE_H__
+
+#include "desutils.h"
+
+/* Schedules kept by default, about 200 KiB of Triple DES contexts */
+#define DES_CACHE_SIZE	256
+
+typedef struct des_cache des_cache;
+
+typedef struct {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+	int entries;		/* Schedules held now */
+	int size;		/* Most it will hold */
+} des_cache_stats;
+
+des_cache *des_cache_create(int);
+void des_cache_destroy(des_cache *);
+des_ctx *des_cache_key(des_cache *, unsigned char *);
+des3_ctx *des3_cache_key(des_cache *, unsigned char *, int);
+void des_cache_get_stats(des_cache *, des_cache_stats *);
+
+#endif	// __DESCACHE_H__
@@ -0,0 +1,880 @@
+/*
+ * desfile.c - File and stream encryption for the DES Test Program
+ *
+ * Streams any amount of binary data from one file descriptor to
+ * another through ECB, CBC or CTR, DES_FILE_BUF bytes at a time. Each
+ * buffer is handed to the bulk (and, with a pool, threaded) calls in
+ * one piece, so there is one read() and one write() per megabyte.
+ * des_file_mmap() does the same on memory mapped files, without the
+ * copies through a user buffer, and des_file_async() overlaps the I/O
+ * with the crypting.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "desfile.h"
+#include "desprof.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#define DES_HAVE_IO_URING
+#endif
+#endif
+
+/* Read until len bytes are in or the input ends. Returns the count,
+ * or -1 on error.
+ */
+static long read_full(int fd, unsigned char *buf, long len)
+{
+	long got, n;
+
+	for( got = 0; got < len; got += n )
+	{
+		DES_PROF_START(t);
+		n = read(fd, buf + got, len - got);
+		DES_PROF_END(DES_PROF_IO, t);
+		if( n < 0 && errno == EINTR )
+			n = 0;
+		else if( n < 0 )
+			return -1;
+		else if( n == 0 )
+			break;
+	}
+	return got;
+}
+
+static int write_full(int fd, unsigned char *buf, long len)
+{
+	long n;
+
+	for( ; len > 0; len -= n, buf += n )
+	{
+		DES_PROF_START(t);
+		n = write(fd, buf, len);
+		DES_PROF_END(DES_PROF_IO, t);
+		if( n < 0 && errno == EINTR )
+			n = 0;
+		else if( n < 0 )
+			return -1;
+	}
+	return 0;
+}
+
+/* Run len bytes in place (whole blocks, except for a CTR tail) through
+ * f's mode, without padding. f->iv is updated for the next buffer.
+ */
+void des_file_buf(des_file *f, unsigned char *buf, long len)
+{
+	long blocks = len / 8;
+
+	if( f->chain == DES_CTR )
+	{
+		if( f->d3 )
+			des3_pool_ctr(f->pool, f->d3, f->iv, buf, len);
+		else
+			des_pool_ctr(f->pool, f->dc, f->iv, buf, len);
+	}
+	else if( f->chain == DES_CBC && f->encrypt )
+	{
+		if( f->d3 )
+			des3_cbc_enc(f->d3, f->iv, buf, blocks);
+		else
+			des_cbc_enc(f->dc, f->iv, buf, blocks);
+	}
+	else if( f->chain == DES_CBC )
+	{
+		if( f->d3 )
+			des3_pool_cbc_dec(f->pool, f->d3, f->iv, buf, blocks);
+		else
+			des_pool_cbc_dec(f->pool, f->dc, f->iv, buf, blocks);
+	}
+	else if( f->encrypt )
+	{
+		if( f->d3 )
+			des3_pool_enc(f->pool, f->d3, buf, blocks);
+		else
+			des_pool_enc(f->pool, f->dc, buf, blocks);
+	}
+	else
+	{
+		if( f->d3 )
+			des3_pool_dec(f->pool, f->d3, buf, blocks);
+		else
+			des_pool_dec(f->pool, f->dc, buf, blocks);
+	}
+}
+
+/* Pad the len byte tail at buf to a whole block; returns the new length */
+static long add_pad(int pad, unsigned char *buf, long len)
+{
+	int n = 8 - len % 8;
+
+	if( pad == DES_PAD_PKCS5 )
+		memset(buf + len, n, n);
+	else
+	{
+		buf[len] = 0x80;
+		memset(buf + len + 1, 0, n - 1);
+	}
+	return len + n;
+}
+
+/* Length of the decrypted len bytes at buf without their padding, or
+ * -1 if the padding is not valid.
+ */
+static long strip_pad(int pad, unsigned char *buf, long len)
+{
+	int i, n;
+
+	if( len == 0 )
+		return -1;
+	if( pad == DES_PAD_PKCS5 )
+	{
+		n = buf[len - 1];
+		if( n < 1 || n > 8 )
+			return -1;
+		for( i = 1; i <= n; i++ )
+			if( buf[len - i] != n )
+				return -1;
+		return len - n;
+	}
+	for( i = 1; i <= 8 && buf[len - i] == 0; i++ )
+		;
+	if( i > 8 || buf[len - i] != 0x80 )
+		return -1;
+	return len - i;
+}
+
+/* Crypt the last have bytes of the input, at buf (which has room for
+ * a block of padding): pad or unpad them as need be. Returns their new
+ * length, or a DES_FILE_* error.
+ */
+static long crypt_final(des_file *f, int pad, unsigned char *buf, long have)
+{
+	if( f->encrypt && pad != DES_PAD_NONE )
+		have = add_pad(pad, buf, have);
+	if( f->chain != DES_CTR && have % 8 != 0 )
+		return DES_FILE_ELEN;
+	des_file_buf(f, buf, have);
+	if( !f->encrypt && pad != DES_PAD_NONE )
+	{
+		have = strip_pad(pad, buf, have);
+		if( have < 0 )
+			return DES_FILE_EPAD;
+	}
+	return have;
+}
+
+/* Encrypt or decrypt everything from in to out. A padded decrypt
+ * holds the last block back until it is known to be the last, so the
+ * padding is checked and dropped before it is written. Returns 0 or a
+ * DES_FILE_* error.
+ */
+int des_file_crypt(des_file *f, int in, int out)
+{
+	unsigned char *buf;
+	long keep, have, len, n;
+	int pad, err;
+
+	pad = f->chain == DES_CTR ? DES_PAD_NONE : f->pad;
+	/* Room for a block of padding past the end */
+	if( posix_memalign((void **)&buf, 4096, DES_FILE_BUF + 8) != 0 )
+		return DES_FILE_EMEM;
+
+	err = 0;
+	keep = 0;
+	for(;;)
+	{
+		n = read_full(in, buf + keep, DES_FILE_BUF - keep);
+		if( n < 0 )
+		{
+			err = DES_FILE_EIO;
+			break;
+		}
+		have = keep + n;
+		if( have < DES_FILE_BUF )
+			break;
+
+		/* A full buffer; there may be more to come */
+		len = have;
+		if( !f->encrypt && pad != DES_PAD_NONE )
+			len -= 8;
+		des_file_buf(f, buf, len);
+		if( write_full(out, buf, len) < 0 )
+		{
+			err = DES_FILE_EIO;
+			break;
+		}
+		keep = have - len;
+		memmove(buf, buf + len, keep);
+	}
+
+	if( err == 0 )
+	{
+		have = crypt_final(f, pad, buf, have);
+		if( have < 0 )
+			err = have;
+		else if( write_full(out, buf, have) < 0 )
+			err = DES_FILE_EIO;
+	}
+
+	free(buf);
+	return err;
+}
+
+/* Map len bytes of fd, or return NULL. Zero bytes map to a dummy
+ * pointer, as mmap() refuses them.
+ */
+static unsigned char *map_file(int fd, long len, int prot)
+{
+	void *p;
+
+	if( len == 0 )
+		return (unsigned char *)"";
+	p = mmap(NULL, len, prot, MAP_SHARED, fd, 0);
+	if( p == MAP_FAILED )
+		return NULL;
+	madvise(p, len, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+	madvise(p, len, MADV_HUGEPAGE);
+#endif
+	return p;
+}
+
+static void unmap_file(unsigned char *p, long len)
+{
+	if( len > 0 )
+		munmap(p, len);
+}
+
+/* As des_file_crypt(), but on memory mapped files: in must be a
+ * regular file. With out < 0 the file is done in place (in must then
+ * be open read/write), otherwise out is sized to the result, mapped,
+ * and each DES_FILE_BUF piece is copied across and crypted while it is
+ * still in cache. The kernels work directly on the mapped pages.
+ * Padding grows or shrinks the file as needed. An in place decrypt
+ * that finds bad padding leaves the file decrypted but unshortened.
+ */
+int des_file_mmap(des_file *f, int in, int out)
+{
+	struct stat st;
+	unsigned char *src, *dst;
+	long len, total, mapped, off, n, copy;
+	int pad, err, fd;
+
+	pad = f->chain == DES_CTR ? DES_PAD_NONE : f->pad;
+	if( fstat(in, &st) < 0 )
+		return DES_FILE_EIO;
+	len = st.st_size;
+	total = len;
+	if( f->encrypt && pad != DES_PAD_NONE )
+		total = len + 8 - len % 8;
+	if( f->chain != DES_CTR && total % 8 != 0 )
+		return DES_FILE_ELEN;
+	if( !f->encrypt && pad != DES_PAD_NONE && total == 0 )
+		return DES_FILE_EPAD;
+
+	fd = out < 0 ? in : out;
+	if( (out >= 0 || total != len) && ftruncate(fd, total) < 0 )
+		return DES_FILE_EIO;
+	mapped = total;
+	dst = map_file(fd, mapped, PROT_READ | PROT_WRITE);
+	if( dst == NULL )
+		return DES_FILE_EIO;
+	src = dst;
+	if( out >= 0 )
+	{
+		src = map_file(in, len, PROT_READ);
+		if( src == NULL )
+		{
+			unmap_file(dst, mapped);
+			return DES_FILE_EIO;
+		}
+	}
+
+	if( total != len )
+		add_pad(pad, dst + len - len % 8, len % 8);
+
+	for( off = 0; off < total; off += n )
+	{
+		n = total - off < DES_FILE_BUF ? total - off : DES_FILE_BUF;
+		if( src != dst )
+		{
+			copy = len - off < n ? len - off : n;
+			memcpy(dst + off, src + off, copy);
+		}
+		des_file_buf(f, dst + off, n);
+	}
+
+	err = 0;
+	if( !f->encrypt && pad != DES_PAD_NONE )
+	{
+		n = strip_pad(pad, dst, total);
+		if( n < 0 )
+			err = DES_FILE_EPAD;
+		else
+			total = n;
+	}
+
+	if( src != dst )
+		unmap_file(src, len);
+	unmap_file(dst, mapped);
+	if( err == 0 && total != mapped && ftruncate(fd, total) < 0 )
+		err = DES_FILE_EIO;
+	return err;
+}
+
+/* Asynchronous pipeline. depth buffers cycle through read, crypt and
+ * write, so the disks and the CPUs are busy at the same time. The
+ * crypt stage always runs on the calling thread, in file order, and
+ * uses the pool for the parallel modes; that keeps CBC and CTR chaining
+ * across buffers exactly as in des_file_crypt().
+ *
+ * Two I/O engines move the buffers. With io_uring, reads and writes of
+ * many buffers are all in flight at once at fixed file offsets, so it
+ * needs regular files on both sides. Otherwise a reader and a writer
+ * thread each do one buffer at a time with plain read() and write().
+ */
+
+enum {
+	SLOT_FREE,		/* Empty, may be read into */
+	SLOT_READING,		/* Read in flight (io_uring) */
+	SLOT_READY,		/* Read done, to be crypted */
+	SLOT_WRITING		/* Crypted, write pending or in flight */
+};
+
+typedef struct {
+	unsigned char *buf;	/* DES_FILE_BUF + 8 bytes */
+	long len;		/* Bytes of data in buf */
+	long done;		/* Bytes read or written so far (io_uring) */
+	int last;		/* Last buffer of the file */
+	int state;
+} aio_slot;
+
+static aio_slot *slots_alloc(int depth)
+{
+	aio_slot *slot;
+	int i;
+
+	slot = calloc(depth, sizeof(*slot));
+	if( slot == NULL )
+		return NULL;
+	for( i = 0; i < depth; i++ )
+	{
+		if( posix_memalign((void **)&slot[i].buf, 4096, DES_FILE_BUF + 8) != 0 )
+		{
+			while( --i >= 0 )
+				free(slot[i].buf);
+			free(slot);
+			return NULL;
+		}
+	}
+	return slot;
+}
+
+static void slots_free(aio_slot *slot, int depth)
+{
+	int i;
+
+	for( i = 0; i < depth; i++ )
+		free(slot[i].buf);
+	free(slot);
+}
+
+/* Crypt stage for one buffer; returns 0 or a DES_FILE_* error */
+static int aio_crypt(des_file *f, int pad, aio_slot *s)
+{
+	if( !s->last )
+	{
+		des_file_buf(f, s->buf, s->len);
+		return 0;
+	}
+	s->len = crypt_final(f, pad, s->buf, s->len);
+	return s->len < 0 ? (int)s->len : 0;
+}
+
+/* The thread engine */
+
+typedef struct {
+	des_file *f;
+	int in, out;
+	int pad;
+	int depth;
+	aio_slot *slot;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;		/* Any slot changed state */
+	int err;			/* First error, stops everything */
+	int saved_errno;
+} aio_pipe;
+
+/* Wait for slot s to reach state, or an error. Called locked. Once a
+ * slot is passed on with pipe_set() it belongs to the next stage, so
+ * anything still needed from it must be read first.
+ */
+static int pipe_wait(aio_pipe *p, aio_slot *s, int state)
+{
+	while( s->state != state && p->err == 0 )
+		pthread_cond_wait(&p->cond, &p->lock);
+	return p->err == 0;
+}
+
+static void pipe_set(aio_pipe *p, aio_slot *s, int state, int err)
+{
+	pthread_mutex_lock(&p->lock);
+	s->state = state;
+	if( err != 0 && p->err == 0 )
+	{
+		p->err = err;
+		p->saved_errno = errno;
+	}
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->lock);
+}
+
+/* Fill the slots in turn. A padded decrypt carries the last block of
+ * every full buffer over into the next one, as des_file_crypt() does,
+ * so the padding always arrives in the last buffer.
+ */
+static void *pipe_reader(void *arg)
+{
+	aio_pipe *p = arg;
+	aio_slot *s;
+	unsigned char held[8];
+	long n, carry;
+	int k, ok, last;
+
+	carry = 0;
+	for( k = 0; ; k++ )
+	{
+		s = &p->slot[k % p->depth];
+		pthread_mutex_lock(&p->lock);
+		ok = pipe_wait(p, s, SLOT_FREE);
+		pthread_mutex_unlock(&p->lock);
+		if( !ok )
+			break;
+
+		memcpy(s->buf, held, carry);
+		n = read_full(p->in, s->buf + carry, DES_FILE_BUF - carry);
+		if( n < 0 )
+		{
+			pipe_set(p, s, SLOT_FREE, DES_FILE_EIO);
+			break;
+		}
+		s->len = carry + n;
+		s->last = s->len < DES_FILE_BUF;
+		carry = 0;
+		if( !s->last && !p->f->encrypt && p->pad != DES_PAD_NONE )
+		{
+			carry = 8;
+			s->len -= carry;
+			memcpy(held, s->buf + s->len, carry);
+		}
+		last = s->last;
+		pipe_set(p, s, SLOT_READY, 0);
+		if( last )
+			break;
+	}
+	return NULL;
+}
+
+static void *pipe_writer(void *arg)
+{
+	aio_pipe *p = arg;
+	aio_slot *s;
+	int k, ok, last;
+
+	for( k = 0; ; k++ )
+	{
+		s = &p->slot[k % p->depth];
+		pthread_mutex_lock(&p->lock);
+		ok = pipe_wait(p, s, SLOT_WRITING);
+		pthread_mutex_unlock(&p->lock);
+		if( !ok )
+			break;
+
+		last = s->last;
+		if( write_full(p->out, s->buf, s->len) < 0 )
+		{
+			pipe_set(p, s, SLOT_FREE, DES_FILE_EIO);
+			break;
+		}
+		pipe_set(p, s, SLOT_FREE, 0);
+		if( last )
+			break;
+	}
+	return NULL;
+}
+
+static int file_threads(des_file *f, int pad, int in, int out, int depth)
+{
+	aio_pipe p;
+	aio_slot *s;
+	pthread_t rd, wr;
+	int k, ok, last, err;
+
+	memset(&p, 0, sizeof(p));
+	p.f = f;
+	p.in = in;
+	p.out = out;
+	p.pad = pad;
+	p.depth = depth;
+	p.slot = slots_alloc(depth);
+	if( p.slot == NULL )
+		return DES_FILE_EMEM;
+	pthread_mutex_init(&p.lock, NULL);
+	pthread_cond_init(&p.cond, NULL);
+
+	if( pthread_create(&rd, NULL, pipe_reader, &p) != 0 )
+	{
+		err = DES_FILE_EMEM;
+		goto done;
+	}
+	if( pthread_create(&wr, NULL, pipe_writer, &p) != 0 )
+	{
+		pthread_mutex_lock(&p.lock);
+		p.err = DES_FILE_EMEM;
+		pthread_cond_broadcast(&p.cond);
+		pthread_mutex_unlock(&p.lock);
+		pthread_join(rd, NULL);
+		err = DES_FILE_EMEM;
+		goto done;
+	}
+
+	for( k = 0; ; k++ )
+	{
+		s = &p.slot[k % depth];
+		pthread_mutex_lock(&p.lock);
+		ok = pipe_wait(&p, s, SLOT_READY);
+		pthread_mutex_unlock(&p.lock);
+		if( !ok )
+			break;
+		err = aio_crypt(f, pad, s);
+		last = s->last;
+		pipe_set(&p, s, SLOT_WRITING, err);
+		if( err != 0 || last )
+			break;
+	}
+
+	pthread_join(rd, NULL);
+	pthread_join(wr, NULL);
+	err = p.err;
+	errno = p.saved_errno;
+done:
+	pthread_cond_destroy(&p.cond);
+	pthread_mutex_destroy(&p.lock);
+	slots_free(p.slot, depth);
+	return err;
+}
+
+#ifdef DES_HAVE_IO_URING
+
+/* The io_uring engine, straight on the system calls */
+
+typedef struct {
+	int fd;
+	unsigned *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring, *cq_ring;
+	size_t sq_len, cq_len, sqe_len;
+	unsigned queued;		/* SQEs not yet submitted */
+	int inflight;			/* Submitted, not yet reaped */
+} uring;
+
+static int uring_init(uring *r, unsigned entries)
+{
+	struct io_uring_params p;
+
+	memset(r, 0, sizeof(*r));
+	memset(&p, 0, sizeof(p));
+	r->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if( r->fd < 0 )
+		return -1;
+
+	r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if( p.features & IORING_FEAT_SINGLE_MMAP )
+	{
+		if( r->cq_len > r->sq_len )
+			r->sq_len = r->cq_len;
+		r->cq_len = r->sq_len;
+	}
+	r->sqe_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	r->sq_ring = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	r->cq_ring = r->sq_ring;
+	if( r->sq_ring != MAP_FAILED && !(p.features & IORING_FEAT_SINGLE_MMAP) )
+		r->cq_ring = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+	r->sqes = mmap(NULL, r->sqe_len, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if( r->sq_ring == MAP_FAILED || r->cq_ring == MAP_FAILED || r->sqes == MAP_FAILED )
+	{
+		if( r->sqes != MAP_FAILED )
+			munmap(r->sqes, r->sqe_len);
+		if( r->cq_ring != MAP_FAILED && r->cq_ring != r->sq_ring )
+			munmap(r->cq_ring, r->cq_len);
+		if( r->sq_ring != MAP_FAILED )
+			munmap(r->sq_ring, r->sq_len);
+		close(r->fd);
+		return -1;
+	}
+
+	r->sq_tail = (unsigned *)((char *)r->sq_ring + p.sq_off.tail);
+	r->sq_mask = (unsigned *)((char *)r->sq_ring + p.sq_off.ring_mask);
+	r->sq_array = (unsigned *)((char *)r->sq_ring + p.sq_off.array);
+	r->cq_head = (unsigned *)((char *)r->cq_ring + p.cq_off.head);
+	r->cq_tail = (unsigned *)((char *)r->cq_ring + p.cq_off.tail);
+	r->cq_mask = (unsigned *)((char *)r->cq_ring + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)((char *)r->cq_ring + p.cq_off.cqes);
+	return 0;
+}
+
+static void uring_free(uring *r)
+{
+	munmap(r->sqes, r->sqe_len);
+	if( r->cq_ring != r->sq_ring )
+		munmap(r->cq_ring, r->cq_len);
+	munmap(r->sq_ring, r->sq_len);
+	close(r->fd);
+}
+
+/* Queue a read or write; the ring is sized so it never fills */
+static void uring_queue(uring *r, int op, int fd, unsigned char *buf,
+			long len, long off, unsigned long tag)
+{
+	struct io_uring_sqe *sqe;
+	unsigned tail, idx;
+
+	tail = *r->sq_tail;
+	idx = tail & *r->sq_mask;
+	sqe = &r->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = op;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long)buf;
+	sqe->len = len;
+	sqe->off = off;
+	sqe->user_data = tag;
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	r->queued++;
+	r->inflight++;
+}
+
+/* Submit what is queued and, if wait, block for one completion */
+static int uring_enter(uring *r, int wait)
+{
+	long n;
+
+	if( r->queued == 0 && !wait )
+		return 0;
+	do
+		n = syscall(__NR_io_uring_enter, r->fd, r->queued, wait ? 1 : 0,
+			wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	while( n < 0 && errno == EINTR );
+	if( n < 0 )
+		return -1;
+	r->queued -= n;
+	return 0;
+}
+
+static int uring_reap(uring *r, unsigned long *tag, int *res)
+{
+	struct io_uring_cqe *cqe;
+	unsigned head;
+
+	head = *r->cq_head;
+	if( head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE) )
+		return 0;
+	cqe = &r->cqes[head & *r->cq_mask];
+	*tag = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+	r->inflight--;
+	return 1;
+}
+
+/* Buffer k of the file lives at offset k * DES_FILE_BUF in both files
+ * (only the last one changes length), and in slot k % depth. A tag is
+ * k * 2, plus 1 for a write. The file size is known up front, so the
+ * last buffer is known without holding anything back.
+ */
+static int file_uring(des_file *f, int pad, int in, int out, int depth)
+{
+	uring r;
+	aio_slot *slot, *s;
+	struct stat st;
+	long size, nbufs, rd, cr, wr, k;
+	unsigned long tag;
+	int res, err, saved;
+
+	if( fstat(in, &st) < 0 )
+		return DES_FILE_EIO;
+	size = st.st_size;
+	nbufs = size == 0 ? 1 : (size + DES_FILE_BUF - 1) / DES_FILE_BUF;
+	if( uring_init(&r, depth * 2) < 0 )
+		return DES_FILE_ENOAIO;
+	slot = slots_alloc(depth);
+	if( slot == NULL )
+	{
+		uring_free(&r);
+		return DES_FILE_EMEM;
+	}
+
+	err = 0;
+	saved = 0;
+	rd = cr = wr = 0;		/* Buffers read, crypted, written */
+	while( wr < nbufs && err == 0 )
+	{
+		/* Start reads into every free slot */
+		for( ; rd < nbufs && slot[rd % depth].state == SLOT_FREE; rd++ )
+		{
+			s = &slot[rd % depth];
+			s->len = size - rd * DES_FILE_BUF;
+			if( s->len > DES_FILE_BUF )
+				s->len = DES_FILE_BUF;
+			s->last = rd == nbufs - 1;
+			s->done = 0;
+			s->state = SLOT_READING;
+			if( s->len == 0 )
+				s->state = SLOT_READY;
+			else
+				uring_queue(&r, IORING_OP_READ, in, s->buf, s->len,
+					rd * DES_FILE_BUF, rd * 2);
+		}
+
+		/* Crypt the next buffer while the I/O runs */
+		s = &slot[cr % depth];
+		if( cr < rd && s->state == SLOT_READY )
+		{
+			if( uring_enter(&r, 0) < 0 )
+			{
+				err = DES_FILE_EIO;
+				break;
+			}
+			err = aio_crypt(f, pad, s);
+			if( err != 0 )
+				break;
+			s->done = 0;
+			s->state = SLOT_WRITING;
+			if( s->len == 0 )
+			{
+				s->state = SLOT_FREE;
+				wr++;
+			}
+			else
+				uring_queue(&r, IORING_OP_WRITE, out, s->buf, s->len,
+					cr * DES_FILE_BUF, cr * 2 + 1);
+			cr++;
+			continue;
+		}
+
+		if( uring_enter(&r, 1) < 0 )
+		{
+			err = DES_FILE_EIO;
+			break;
+		}
+		while( err == 0 && uring_reap(&r, &tag, &res) )
+		{
+			k = tag / 2;
+			s = &slot[k % depth];
+			if( res <= 0 )
+			{
+				/* 0 means the input shrank under us */
+				saved = res < 0 ? -res : EIO;
+				err = DES_FILE_EIO;
+				break;
+			}
+			s->done += res;
+			if( s->done < s->len )
+				uring_queue(&r, tag & 1 ? IORING_OP_WRITE : IORING_OP_READ,
+					tag & 1 ? out : in, s->buf + s->done,
+					s->len - s->done, k * DES_FILE_BUF + s->done, tag);
+			else if( tag & 1 )
+			{
+				s->state = SLOT_FREE;
+				wr++;
+			}
+			else
+				s->state = SLOT_READY;
+		}
+	}
+
+	/* Let anything still in flight finish before freeing its buffer */
+	while( r.inflight > 0 && uring_enter(&r, 1) == 0 )
+		while( uring_reap(&r, &tag, &res) )
+			;
+	slots_free(slot, depth);
+	uring_free(&r);
+	if( saved != 0 )
+		errno = saved;
+	return err;
+}
+
+#endif	/* DES_HAVE_IO_URING */
+
+/* Run the pipeline with depth buffers (0 for DES_FILE_DEPTH) on the
+ * given engine. DES_AIO_AUTO uses io_uring for regular files where the
+ * kernel has it and threads otherwise. Returns 0 or a DES_FILE_*
+ * error; DES_FILE_ENOAIO if DES_AIO_URING was asked for and can't be
+ * used.
+ */
+int des_file_async(des_file *f, int in, int out, int depth, int engine)
+{
+#ifdef DES_HAVE_IO_URING
+	struct stat a, b;
+#endif
+	int pad, err;
+
+	pad = f->chain == DES_CTR ? DES_PAD_NONE : f->pad;
+	if( depth <= 0 )
+		depth = DES_FILE_DEPTH;
+	if( depth < 2 )
+		depth = 2;
+
+	if( engine != DES_AIO_THREADS )
+	{
+		err = DES_FILE_ENOAIO;
+#ifdef DES_HAVE_IO_URING
+		if( fstat(in, &a) == 0 && S_ISREG(a.st_mode) &&
+		    fstat(out, &b) == 0 && S_ISREG(b.st_mode) )
+			err = file_uring(f, pad, in, out, depth);
+#endif
+		if( err != DES_FILE_ENOAIO || engine == DES_AIO_URING )
+			return err;
+	}
+	return file_threads(f, pad, in, out, depth);
+}
+
+const char *des_file_error(int err)
+{
+	switch( err )
+	{
+		case 0:
+			return "no error";
+		case DES_FILE_EIO:
+			return strerror(errno);
+		case DES_FILE_ELEN:
+			return "input is not a whole number of 8 byte blocks";
+		case DES_FILE_EPAD:
+			return "bad padding (wrong key, IV or mode?)";
+		case DES_FILE_EMEM:
+			return "out of memory";
+		case DES_FILE_ENOAIO:
+			return "io_uring not available for these files";
+	}
+	return "unknown error";
+}
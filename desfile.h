@@ -0,0 +1,66 @@
+/*
+ * desfile.h - File and stream encryption for the DES Test Program
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __DESFILE_H__
+#define __DESFILE_H__
+
+#include "desutils.h"
+#include "despool.h"
+
+/* Bytes read or written per syscall. A multiple of the pool grain, so
+ * every buffer splits evenly across the workers. */
+#define DES_FILE_BUF	(1024 * 1024)
+
+/* Buffers in flight in des_file_async() by default */
+#define DES_FILE_DEPTH	8
+
+/* Chaining modes */
+enum {
+	DES_ECB,
+	DES_CBC,
+	DES_CTR
+};
+
+/* Padding for ECB and CBC. CTR is never padded. */
+enum {
+	DES_PAD_NONE,		/* Input must be whole blocks */
+	DES_PAD_PKCS5,		/* n bytes of value n, 1 <= n <= 8 */
+	DES_PAD_ISO		/* ISO/IEC 7816-4: 0x80 then zeros */
+};
+
+/* Errors from des_file_crypt() */
+#define DES_FILE_EIO	-1	/* read() or write() failed, see errno */
+#define DES_FILE_ELEN	-2	/* Input not whole blocks */
+#define DES_FILE_EPAD	-3	/* Bad padding on decrypt */
+#define DES_FILE_EMEM	-4	/* No memory for the buffer */
+#define DES_FILE_ENOAIO	-5	/* io_uring asked for, not usable */
+
+/* I/O engines for des_file_async() */
+enum {
+	DES_AIO_AUTO,		/* io_uring if it can, else threads */
+	DES_AIO_URING,
+	DES_AIO_THREADS
+};
+
+typedef struct {
+	des_ctx *dc;		/* Single DES key, or */
+	des3_ctx *d3;		/* Triple DES key */
+	des_pool *pool;		/* Workers, may be NULL */
+	int encrypt;		/* 1 = encrypt, 0 = decrypt */
+	int chain;		/* DES_ECB, DES_CBC or DES_CTR */
+	int pad;		/* DES_PAD_* */
+	unsigned char iv[8];	/* CBC IV or CTR counter, updated */
+} des_file;
+
+void des_file_buf(des_file *, unsigned char *, long);
+int des_file_crypt(des_file *, int, int);
+int des_file_mmap(des_file *, int, int);
+int des_file_async(des_file *, int, int, int, int);
+const char *des_file_error(int);
+
+#endif	// __DESFILE_H__
@@ -0,0 +1,298 @@
+/*
+ * deshex.c - Hex encoding and decoding for the DES Test Program
+ *
+ * des_hex_decode() packs 2n hex digits (either case) into n bytes and
+ * fails on anything that is not a hex digit. des_hex_encode() is the
+ * reverse, in upper case. On x86 both run 16 or 32 bytes at a time
+ * with SSSE3 or AVX2 shuffles, picked at run time from cpuid like the
+ * DES kernels; the tail and other CPUs use the scalar code.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "deshex.h"
+
+#ifdef DES_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+typedef struct {
+	const char *name;
+	int (*decode)(const char *, unsigned char *, long);
+	void (*encode)(const unsigned char *, char *, long);
+	int (*supported)(void);
+} hex_impl;
+
+static const char hexdigits[] = "0123456789ABCDEF";
+
+/* Value of each hex digit, -1 for everything else */
+static const signed char hexval[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+
+static int decode_scalar(const char *hex, unsigned char *out, long n)
+{
+	register int hi, lo, bad;
+	register long i;
+
+	bad = 0;
+	for( i = 0; i < n; i++ )
+	{
+		hi = hexval[(unsigned char)hex[2 * i]];
+		lo = hexval[(unsigned char)hex[2 * i + 1]];
+		bad |= hi | lo;
+		out[i] = (hi << 4) | (lo & 0x0f);
+	}
+	return bad < 0 ? -1 : 0;
+}
+
+static void encode_scalar(const unsigned char *in, char *hex, long n)
+{
+	register long i;
+
+	for( i = 0; i < n; i++ )
+	{
+		hex[2 * i] = hexdigits[in[i] >> 4];
+		hex[2 * i + 1] = hexdigits[in[i] & 0x0f];
+	}
+}
+
+static int cpu_any(void)
+{
+	return 1;
+}
+
+#ifdef DES_X86_KERNELS
+static int cpu_ssse3(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+}
+
+static int cpu_avx2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+/* Nibble values of 16 hex digits; *ok gets a lane mask of the valid
+   ones. '0'-'9' and 'a'-'f' (after folding case) are found with an
+   unsigned min, as SSE has no unsigned byte compare. */
+__attribute__((target("ssse3")))
+static inline __m128i nibbles_ssse3(__m128i v, int *ok)
+{
+	__m128i d, a, isd, isa;
+
+	d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+	a = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	isd = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+	isa = _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(5)), a);
+	*ok = _mm_movemask_epi8(_mm_or_si128(isd, isa));
+	return _mm_or_si128(_mm_and_si128(isd, d),
+		_mm_and_si128(isa, _mm_add_epi8(a, _mm_set1_epi8(10))));
+}
+
+__attribute__((target("ssse3")))
+static int decode_ssse3(const char *hex, unsigned char *out, long n)
+{
+	__m128i x, y, w;
+	int okx, oky, bad;
+	long i;
+
+	/* Each digit pair becomes hi * 16 + lo in one 16-bit lane */
+	w = _mm_set1_epi16(0x0110);
+	bad = 0;
+	for( i = 0; i + 16 <= n; i += 16 )
+	{
+		x = nibbles_ssse3(_mm_loadu_si128((const __m128i *)(hex + 2 * i)), &okx);
+		y = nibbles_ssse3(_mm_loadu_si128((const __m128i *)(hex + 2 * i + 16)), &oky);
+		bad |= (okx & oky) ^ 0xffff;
+		x = _mm_maddubs_epi16(x, w);
+		y = _mm_maddubs_epi16(y, w);
+		_mm_storeu_si128((__m128i *)(out + i), _mm_packus_epi16(x, y));
+	}
+	/* One DES block, the common case for keys */
+	if( i + 8 <= n )
+	{
+		x = nibbles_ssse3(_mm_loadu_si128((const __m128i *)(hex + 2 * i)), &okx);
+		bad |= okx ^ 0xffff;
+		x = _mm_maddubs_epi16(x, w);
+		_mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(x, x));
+		i += 8;
+	}
+	if( decode_scalar(hex + 2 * i, out + i, n - i) != 0 )
+		bad = 1;
+	return bad ? -1 : 0;
+}
+
+__attribute__((target("ssse3")))
+static void encode_ssse3(const unsigned char *in, char *hex, long n)
+{
+	__m128i lut, m, v, hi, lo;
+	long i;
+
+	lut = _mm_loadu_si128((const __m128i *)hexdigits);
+	m = _mm_set1_epi8(0x0f);
+	for( i = 0; i + 16 <= n; i += 16 )
+	{
+		v = _mm_loadu_si128((const __m128i *)(in + i));
+		hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), m));
+		lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, m));
+		_mm_storeu_si128((__m128i *)(hex + 2 * i), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i *)(hex + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+	}
+	encode_scalar(in + i, hex + 2 * i, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i nibbles_avx2(__m256i v, int *ok)
+{
+	__m256i d, a, isd, isa;
+
+	d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+	a = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+	isd = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+	isa = _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_set1_epi8(5)), a);
+	*ok = _mm256_movemask_epi8(_mm256_or_si256(isd, isa));
+	return _mm256_or_si256(_mm256_and_si256(isd, d),
+		_mm256_and_si256(isa, _mm256_add_epi8(a, _mm256_set1_epi8(10))));
+}
+
+__attribute__((target("avx2")))
+static int decode_avx2(const char *hex, unsigned char *out, long n)
+{
+	__m256i x, y, w;
+	int okx, oky, bad;
+	long i;
+
+	w = _mm256_set1_epi16(0x0110);
+	bad = 0;
+	for( i = 0; i + 32 <= n; i += 32 )
+	{
+		x = nibbles_avx2(_mm256_loadu_si256((const __m256i *)(hex + 2 * i)), &okx);
+		y = nibbles_avx2(_mm256_loadu_si256((const __m256i *)(hex + 2 * i + 32)), &oky);
+		bad |= ~(okx & oky);
+		x = _mm256_maddubs_epi16(x, w);
+		y = _mm256_maddubs_epi16(y, w);
+		/* packus works within 128-bit halves; put the quarters back */
+		x = _mm256_permute4x64_epi64(_mm256_packus_epi16(x, y), 0xd8);
+		_mm256_storeu_si256((__m256i *)(out + i), x);
+	}
+	if( decode_ssse3(hex + 2 * i, out + i, n - i) != 0 )
+		bad = 1;
+	return bad ? -1 : 0;
+}
+
+__attribute__((target("avx2")))
+static void encode_avx2(const unsigned char *in, char *hex, long n)
+{
+	__m256i lut, m, v, hi, lo, a, b;
+	long i;
+
+	lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hexdigits));
+	m = _mm256_set1_epi8(0x0f);
+	for( i = 0; i + 32 <= n; i += 32 )
+	{
+		v = _mm256_loadu_si256((const __m256i *)(in + i));
+		hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), m));
+		lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, m));
+		a = _mm256_unpacklo_epi8(hi, lo);
+		b = _mm256_unpackhi_epi8(hi, lo);
+		_mm256_storeu_si256((__m256i *)(hex + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256((__m256i *)(hex + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+	}
+	encode_ssse3(in + i, hex + 2 * i, n - i);
+}
+#endif
+
+/* Available versions, best first */
+static hex_impl impls[] = {
+#ifdef DES_X86_KERNELS
+	{ "avx2",   decode_avx2,   encode_avx2,   cpu_avx2 },
+	{ "ssse3",  decode_ssse3,  encode_ssse3,  cpu_ssse3 },
+#endif
+	{ "scalar", decode_scalar, encode_scalar, cpu_any },
+	{ NULL,     NULL,          NULL,          NULL }
+};
+
+static hex_impl *impl = NULL;
+static pthread_once_t impl_once = PTHREAD_ONCE_INIT;
+
+static hex_impl *find_impl(const char *name)
+{
+	hex_impl *h;
+
+	for( h = impls; h->name != NULL; h++ )
+	{
+		if( name == NULL || *name == 0 || strcmp(name,"auto") == 0 )
+		{
+			if( h->supported() )
+				return(h);
+		}
+		else if( strcmp(name,h->name) == 0 )
+			return(h->supported() ? h : NULL);
+	}
+	return(NULL);
+}
+
+static void impl_init(void)
+{
+	impl = find_impl(NULL);
+}
+
+static hex_impl *cur_impl(void)
+{
+	pthread_once(&impl_once,impl_init);
+	return impl;
+}
+
+/* Pack the 2n hex digits at hex into n bytes at out. Returns 0, or -1
+   if any of them is not a hex digit (out is then undefined). */
+int des_hex_decode(const char *hex, unsigned char *out, long n)
+{
+	return cur_impl()->decode(hex, out, n);
+}
+
+/* Write the n bytes at in as 2n upper case hex digits at hex, which
+   is not terminated. */
+void des_hex_encode(const unsigned char *in, char *hex, long n)
+{
+	cur_impl()->encode(in, hex, n);
+}
+
+/* Bind the named version ("avx2", "ssse3", "scalar" or "auto").
+   Returns 0, or -1 if it is unknown or not supported here. */
+int des_hex_set_impl(const char *name)
+{
+	hex_impl *h;
+
+	pthread_once(&impl_once,impl_init);
+	h = find_impl(name);
+	if( h == NULL )
+		return(-1);
+	impl = h;
+	return(0);
+}
+
+const char *des_hex_impl(void)
+{
+	return(cur_impl()->name);
+}
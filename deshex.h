@@ -0,0 +1,17 @@
+/*
+ * deshex.h - Hex encoding and decoding for the DES Test Program
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __DESHEX_H__
+#define __DESHEX_H__
+
+int des_hex_decode(const char *, unsigned char *, long);
+void des_hex_encode(const unsigned char *, char *, long);
+int des_hex_set_impl(const char *);
+const char *des_hex_impl(void);
+
+#endif	// __DESHEX_H__
@@ -0,0 +1,443 @@
+/*
+ * despool.c - Thread pool for bulk DES/TDES operations
+ *
+ * A des_pool is a fixed set of worker threads. Each bulk call splits
+ * its block range into one slice per thread (the calling thread takes
+ * the first slice), runs them and returns when all are done. Only
+ * modes where blocks can be processed independently belong here: ECB,
+ * CTR and CBC decryption.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "desutils.h"
+#include "despool.h"
+#include "desprobe.h"
+
+/* Run slice i: blocks blocks starting at block first of data */
+typedef void (*pool_fn)(void *, unsigned char *, int, long, long);
+
+struct des_pool {
+	int nthreads;			/* Workers, including the caller */
+	pthread_t *tid;
+	pthread_mutex_t run;		/* One bulk call at a time */
+	pthread_mutex_t lock;
+	pthread_cond_t go;
+	pthread_cond_t done;
+	unsigned long gen;		/* Bumped for every job */
+	int pending;			/* Workers still busy on this job */
+	int quit;
+	pool_fn fn;			/* The current job */
+	void *arg;
+	unsigned char *data;
+	long blocks;
+};
+
+typedef struct {
+	des_pool *pool;
+	int index;
+} pool_worker;
+
+/* Range of slice i of n over blocks, split on DES_POOL_GRAIN */
+static void pool_slice(long blocks, int i, int n, long *first, long *count)
+{
+	long grains, start, end;
+
+	grains = (blocks + DES_POOL_GRAIN - 1) / DES_POOL_GRAIN;
+	start = grains * i / n * DES_POOL_GRAIN;
+	end = grains * (i + 1) / n * DES_POOL_GRAIN;
+	if( end > blocks )
+		end = blocks;
+	if( start > end )
+		start = end;
+	*first = start;
+	*count = end - start;
+}
+
+static void pool_do(des_pool *p, int i)
+{
+	long first, count;
+
+	pool_slice(p->blocks, i, p->nthreads, &first, &count);
+	if( count > 0 )
+	{
+		DES_PROBE3(pool_slice_start, i, first, count);
+		p->fn(p->arg, p->data, i, first, count);
+		DES_PROBE2(pool_slice_end, i, count);
+	}
+}
+
+static void *pool_main(void *arg)
+{
+	pool_worker *w = arg;
+	des_pool *p = w->pool;
+	unsigned long seen = 0;
+
+	for(;;)
+	{
+		pthread_mutex_lock(&p->lock);
+		while( p->gen == seen && !p->quit )
+			pthread_cond_wait(&p->go, &p->lock);
+		if( p->quit )
+		{
+			pthread_mutex_unlock(&p->lock);
+			break;
+		}
+		seen = p->gen;
+		pthread_mutex_unlock(&p->lock);
+
+		pool_do(p, w->index);
+
+		pthread_mutex_lock(&p->lock);
+		if( --p->pending == 0 )
+			pthread_cond_signal(&p->done);
+		pthread_mutex_unlock(&p->lock);
+	}
+	free(w);
+	return NULL;
+}
+
+/* Run fn over blocks blocks of data on the pool. A NULL pool, a one
+ * thread pool or a small job runs on the calling thread.
+ */
+static void pool_run(des_pool *p, pool_fn fn, void *arg,
+			unsigned char *data, long blocks)
+{
+	if( p == NULL || p->nthreads < 2 || blocks < (long)DES_POOL_MIN * p->nthreads )
+	{
+		DES_PROBE2(pool_start, blocks, 1);
+		fn(arg, data, 0, 0, blocks);
+		DES_PROBE2(pool_end, blocks, 1);
+		return;
+	}
+
+	DES_PROBE2(pool_start, blocks, p->nthreads);
+
+	pthread_mutex_lock(&p->run);
+	pthread_mutex_lock(&p->lock);
+	p->fn = fn;
+	p->arg = arg;
+	p->data = data;
+	p->blocks = blocks;
+	p->pending = p->nthreads - 1;
+	p->gen++;
+	pthread_cond_broadcast(&p->go);
+	pthread_mutex_unlock(&p->lock);
+
+	pool_do(p, 0);
+
+	pthread_mutex_lock(&p->lock);
+	while( p->pending > 0 )
+		pthread_cond_wait(&p->done, &p->lock);
+	pthread_mutex_unlock(&p->lock);
+	pthread_mutex_unlock(&p->run);
+	DES_PROBE2(pool_end, blocks, p->nthreads);
+}
+
+/* Create a pool of nthreads threads (counting the caller), or one per
+ * online CPU if nthreads is 0. Returns NULL on failure.
+ */
+des_pool *des_pool_create(int nthreads)
+{
+	des_pool *p;
+	pool_worker *w;
+	int i;
+
+	if( nthreads <= 0 )
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if( nthreads <= 0 )
+		nthreads = 1;
+
+	p = calloc(1, sizeof(*p));
+	if( p == NULL )
+		return NULL;
+	p->tid = calloc(nthreads, sizeof(pthread_t));
+	if( p->tid == NULL )
+	{
+		free(p);
+		return NULL;
+	}
+	pthread_mutex_init(&p->run, NULL);
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->go, NULL);
+	pthread_cond_init(&p->done, NULL);
+
+	p->nthreads = 1;
+	for( i = 1; i < nthreads; i++ )
+	{
+		w = malloc(sizeof(*w));
+		if( w == NULL )
+			break;
+		w->pool = p;
+		w->index = i;
+		if( pthread_create(&p->tid[i], NULL, pool_main, w) != 0 )
+		{
+			free(w);
+			break;
+		}
+		p->nthreads++;
+	}
+	return p;
+}
+
+void des_pool_destroy(des_pool *p)
+{
+	int i;
+
+	if( p == NULL )
+		return;
+	pthread_mutex_lock(&p->lock);
+	p->quit = 1;
+	pthread_cond_broadcast(&p->go);
+	pthread_mutex_unlock(&p->lock);
+	for( i = 1; i < p->nthreads; i++ )
+		pthread_join(p->tid[i], NULL);
+	pthread_cond_destroy(&p->done);
+	pthread_cond_destroy(&p->go);
+	pthread_mutex_destroy(&p->lock);
+	pthread_mutex_destroy(&p->run);
+	free(p->tid);
+	free(p);
+}
+
+int des_pool_threads(des_pool *p)
+{
+	return p == NULL ? 1 : p->nthreads;
+}
+
+/* The slice functions. des_enc() and friends take an int count, so
+ * very large slices are fed to them in INT_MAX-sized pieces.
+ */
+#define POOL_STEP	((long)(INT_MAX - INT_MAX % DES_POOL_GRAIN))
+
+static void ecb_enc(void *arg, unsigned char *data, int slice,
+			long first, long blocks)
+{
+	long n;
+
+	for( data += first * 8; blocks > 0; blocks -= n, data += n * 8 )
+	{
+		n = blocks < POOL_STEP ? blocks : POOL_STEP;
+		des_enc(arg, data, n);
+	}
+}
+
+static void ecb_dec(void *arg, unsigned char *data, int slice,
+			long first, long blocks)
+{
+	long n;
+
+	for( data += first * 8; blocks > 0; blocks -= n, data += n * 8 )
+	{
+		n = blocks < POOL_STEP ? blocks : POOL_STEP;
+		des_dec(arg, data, n);
+	}
+}
+
+static void ecb3_enc(void *arg, unsigned char *data, int slice,
+			long first, long blocks)
+{
+	long n;
+
+	for( data += first * 8; blocks > 0; blocks -= n, data += n * 8 )
+	{
+		n = blocks < POOL_STEP ? blocks : POOL_STEP;
+		des3_enc(arg, data, n);
+	}
+}
+
+static void ecb3_dec(void *arg, unsigned char *data, int slice,
+			long first, long blocks)
+{
+	long n;
+
+	for( data += first * 8; blocks > 0; blocks -= n, data += n * 8 )
+	{
+		n = blocks < POOL_STEP ? blocks : POOL_STEP;
+		des3_dec(arg, data, n);
+	}
+}
+
+/* Parallel versions of des_enc/des_dec/des3_enc/des3_dec (ECB) */
+
+void des_pool_enc(des_pool *p, des_ctx *dc, unsigned char *data, long blocks)
+{
+	pool_run(p, ecb_enc, dc, data, blocks);
+}
+
+void des_pool_dec(des_pool *p, des_ctx *dc, unsigned char *data, long blocks)
+{
+	pool_run(p, ecb_dec, dc, data, blocks);
+}
+
+void des3_pool_enc(des_pool *p, des3_ctx *dc, unsigned char *data, long blocks)
+{
+	pool_run(p, ecb3_enc, dc, data, blocks);
+}
+
+void des3_pool_dec(des_pool *p, des3_ctx *dc, unsigned char *data, long blocks)
+{
+	pool_run(p, ecb3_dec, dc, data, blocks);
+}
+
+/* CBC decryption. Slices decrypt in place, so the ciphertext block in
+ * front of each slice - its IV - is saved before any of them start.
+ */
+typedef struct {
+	void *dc;
+	int triple;
+	unsigned char (*iv)[8];		/* Chaining value for each slice */
+} cbc_job;
+
+static void cbc_dec(void *arg, unsigned char *data, int slice,
+			long first, long blocks)
+{
+	cbc_job *job = arg;
+	unsigned char *iv;
+	long n;
+
+	iv = job->iv[slice];
+	for( data += first * 8; blocks > 0; blocks -= n, data += n * 8 )
+	{
+		n = blocks < POOL_STEP ? blocks : POOL_STEP;
+		if( job->triple )
+			des3_cbc_dec(job->dc, iv, data, n);
+		else
+			des_cbc_dec(job->dc, iv, data, n);
+	}
+}
+
+static void pool_cbc_dec(des_pool *p, void *dc, int triple, unsigned char *iv,
+			unsigned char *data, long blocks)
+{
+	cbc_job job;
+	unsigned char one[1][8], last[8];
+	long first, count;
+	int i, n;
+
+	if( blocks <= 0 )
+		return;
+	n = des_pool_threads(p);
+	job.dc = dc;
+	job.triple = triple;
+	job.iv = n > 1 ? malloc(n * sizeof(*job.iv)) : NULL;
+	if( job.iv == NULL )
+	{
+		n = 1;
+		p = NULL;
+		job.iv = one;
+	}
+	memcpy(job.iv[0], iv, 8);
+	for( i = 1; i < n; i++ )
+	{
+		pool_slice(blocks, i, n, &first, &count);
+		if( first > 0 )
+			memcpy(job.iv[i], data + (first - 1) * 8, 8);
+	}
+	memcpy(last, data + (blocks - 1) * 8, 8);
+
+	pool_run(p, cbc_dec, &job, data, blocks);
+
+	if( job.iv != one )
+		free(job.iv);
+	memcpy(iv, last, 8);
+}
+
+/* Parallel versions of des_cbc_dec/des3_cbc_dec. iv is updated to the
+ * last ciphertext block, as in the serial calls.
+ */
+
+void des_pool_cbc_dec(des_pool *p, des_ctx *dc, unsigned char *iv,
+			unsigned char *data, long blocks)
+{
+	pool_cbc_dec(p, dc, 0, iv, data, blocks);
+}
+
+void des3_pool_cbc_dec(des_pool *p, des3_ctx *dc, unsigned char *iv,
+			unsigned char *data, long blocks)
+{
+	pool_cbc_dec(p, dc, 1, iv, data, blocks);
+}
+
+/* CTR. Slice i starts from the counter plus its first block; only the
+ * last slice can end in a partial block. des_ctr() takes an int byte
+ * count, hence the smaller step.
+ */
+#define POOL_CTR_STEP	((long)(INT_MAX / 8 - (INT_MAX / 8) % DES_POOL_GRAIN))
+
+typedef struct {
+	void *dc;
+	int triple;
+	uint64_t ctr;			/* Counter of block 0 */
+	long bytes;
+} ctr_job;
+
+static void ctr_xor(void *arg, unsigned char *data, int slice,
+			long first, long blocks)
+{
+	ctr_job *job = arg;
+	unsigned char ctr[8];
+	uint64_t count;
+	long n, end;
+	int i;
+
+	count = job->ctr + first;
+	for( i = 7; i >= 0; i--, count >>= 8 )
+		ctr[i] = count & 0xff;
+	end = (first + blocks) * 8;
+	if( end > job->bytes )
+		end = job->bytes;
+	for( data += first * 8, end -= first * 8; end > 0; end -= n, data += n )
+	{
+		n = end < POOL_CTR_STEP * 8 ? end : POOL_CTR_STEP * 8;
+		if( job->triple )
+			des3_ctr(job->dc, ctr, data, n);
+		else
+			des_ctr(job->dc, ctr, data, n);
+	}
+}
+
+static void pool_ctr(des_pool *p, void *dc, int triple, unsigned char *ctr,
+			unsigned char *data, long bytes)
+{
+	ctr_job job;
+	long blocks;
+	int i;
+
+	if( bytes <= 0 )
+		return;
+	job.dc = dc;
+	job.triple = triple;
+	job.bytes = bytes;
+	for( job.ctr = 0, i = 0; i < 8; i++ )
+		job.ctr = (job.ctr << 8) | ctr[i];
+	blocks = (bytes + 7) / 8;
+
+	pool_run(p, ctr_xor, &job, data, blocks);
+
+	job.ctr += blocks;
+	for( i = 7; i >= 0; i--, job.ctr >>= 8 )
+		ctr[i] = job.ctr & 0xff;
+}
+
+/* Parallel versions of des_ctr/des3_ctr; bytes need not be a multiple
+ * of 8, and ctr is advanced as in the serial calls.
+ */
+
+void des_pool_ctr(des_pool *p, des_ctx *dc, unsigned char *ctr,
+			unsigned char *data, long bytes)
+{
+	pool_ctr(p, dc, 0, ctr, data, bytes);
+}
+
+void des3_pool_ctr(des_pool *p, des3_ctx *dc, unsigned char *ctr,
+			unsigned char *data, long bytes)
+{
+	pool_ctr(p, dc, 1, ctr, data, bytes);
+}
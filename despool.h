@@ -0,0 +1,38 @@
+/*
+ * despool.h - Thread pool for bulk DES/TDES operations
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __DESPOOL_H__
+#define __DESPOOL_H__
+
+#include "desutils.h"
+
+/* Work is split on multiples of this many blocks (4 KiB), so every
+ * worker starts on a page and cache line boundary of the buffer and
+ * gets whole passes of the widest bitsliced kernel.
+ */
+#define DES_POOL_GRAIN	512
+
+/* Calls smaller than this many blocks per thread run on the caller */
+#define DES_POOL_MIN	(DES_POOL_GRAIN * 4)
+
+typedef struct des_pool des_pool;
+
+des_pool *des_pool_create(int);
+void des_pool_destroy(des_pool *);
+int des_pool_threads(des_pool *);
+
+void des_pool_enc(des_pool *, des_ctx *, unsigned char *, long);
+void des_pool_dec(des_pool *, des_ctx *, unsigned char *, long);
+void des3_pool_enc(des_pool *, des3_ctx *, unsigned char *, long);
+void des3_pool_dec(des_pool *, des3_ctx *, unsigned char *, long);
+void des_pool_cbc_dec(des_pool *, des_ctx *, unsigned char *, unsigned char *, long);
+void des3_pool_cbc_dec(des_pool *, des3_ctx *, unsigned char *, unsigned char *, long);
+void des_pool_ctr(des_pool *, des_ctx *, unsigned char *, unsigned char *, long);
+void des3_pool_ctr(des_pool *, des3_ctx *, unsigned char *, unsigned char *, long);
+
+#endif	// __DESPOOL_H__
@@ -0,0 +1,48 @@
+/*
+ * desprobe.h - USDT probe points for the DES library
+ *
+ * Where <sys/sdt.h> exists (systemtap-sdt-dev / systemtap-sdt-devel),
+ * each DES_PROBE*() is a static tracepoint in provider "des": a single
+ * nop in the code plus a note in the ELF file that perf, bpftrace or
+ * stap use to find it. Nothing runs unless a tracer attaches. Without
+ * the header they expand to nothing.
+ *
+ * Probes, arguments in order:
+ *   key_start, key_end          keys in the schedule (1, 2 or 3)
+ *   ecb_start                   blocks, keys (1 or 3)
+ *   ecb_end                     blocks done by a bitsliced kernel, keys
+ *   mode_start, mode_end        mode name ("des3-cbc-enc"...), bytes,
+ *                               or streams for the "-multi" modes
+ *   pool_start, pool_end        blocks, threads used (1 if run inline)
+ *   pool_slice_start            thread index, first block, blocks
+ *   pool_slice_end              thread index, blocks
+ *
+ * e.g. bpftrace -e 'usdt:./testdes:des:key_start { @t[tid] = nsecs; }
+ *   usdt:./testdes:des:key_end /@t[tid]/ { @ns = hist(nsecs - @t[tid]); }'
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __DESPROBE_H__
+#define __DESPROBE_H__
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define DES_HAVE_SDT
+#endif
+#endif
+
+#ifdef DES_HAVE_SDT
+#define DES_PROBE1(name, a)		DTRACE_PROBE1(des, name, a)
+#define DES_PROBE2(name, a, b)		DTRACE_PROBE2(des, name, a, b)
+#define DES_PROBE3(name, a, b, c)	DTRACE_PROBE3(des, name, a, b, c)
+#else
+#define DES_PROBE1(name, a)
+#define DES_PROBE2(name, a, b)
+#define DES_PROBE3(name, a, b, c)
+#endif
+
+#endif	// __DESPROBE_H__
@@ -0,0 +1,188 @@
+/*
+ * desprof.c - Per-phase cost counters for the DES Test Program
+ *
+ * With -DDES_PROFILE (make PROFILE=1) the hot paths charge the ticks
+ * they take to one of the DES_PROF_* phases: parsing hex, building key
+ * schedules, running the rounds, formatting output and file or line
+ * I/O. Each phase keeps a call count, a tick total, its longest call
+ * and a histogram of calls by power of two ticks. A dump of all of it
+ * goes to stderr at exit, and whenever the process gets SIGUSR1.
+ *
+ * Ticks are TSC cycles on x86 (reference cycles at the TSC rate, not
+ * core clocks) and nanoseconds elsewhere. Counters are updated with
+ * atomic adds, so pool threads can all charge the cipher phase; its
+ * total is then CPU time summed over threads, and can exceed the wall
+ * time.
+ *
+ * The SIGUSR1 handler only sets a flag. The dump is written by the next
+ * thread to finish a phase, so a process blocked on input dumps once
+ * the input arrives.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#ifdef DES_PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "desprof.h"
+
+#define PROF_BUCKETS	65	/* Bucket i holds calls of [2^(i-1), 2^i) ticks */
+#define PROF_BAR	40	/* Widest histogram bar */
+
+typedef struct {
+	uint64_t calls;
+	uint64_t ticks;
+	uint64_t max;
+	uint64_t hist[PROF_BUCKETS];
+} prof_phase;
+
+static const char *phase_names[DES_PROF_PHASES] = {
+	"io", "parse", "key", "cipher", "output" };
+
+static prof_phase phases[DES_PROF_PHASES];
+static volatile sig_atomic_t dump_wanted = 0;
+static uint64_t start_ticks;
+static double start_ns;
+
+static double prof_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#ifndef DES_X86_KERNELS
+uint64_t des_prof_now(void)
+{
+	return (uint64_t)prof_ns();
+}
+#endif
+
+static void prof_signal(int sig)
+{
+	dump_wanted = 1;
+}
+
+static void prof_atexit(void)
+{
+	des_prof_dump(stderr);
+}
+
+/* Start counting from now; dump at exit and on SIGUSR1 */
+void des_prof_init(void)
+{
+	struct sigaction sa;
+
+	start_ns = prof_ns();
+	start_ticks = des_prof_now();
+	memset(&sa,0x00,sizeof(sa));
+	sa.sa_handler = prof_signal;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGUSR1,&sa,NULL);
+	atexit(prof_atexit);
+}
+
+/* Charge ticks to phase p */
+void des_prof_add(int p, uint64_t ticks)
+{
+	prof_phase *ph = &phases[p];
+	uint64_t m;
+	int b;
+
+	b = ticks ? 64 - __builtin_clzll(ticks) : 0;
+	__atomic_fetch_add(&ph->calls,1,__ATOMIC_RELAXED);
+	__atomic_fetch_add(&ph->ticks,ticks,__ATOMIC_RELAXED);
+	__atomic_fetch_add(&ph->hist[b],1,__ATOMIC_RELAXED);
+	m = __atomic_load_n(&ph->max,__ATOMIC_RELAXED);
+	while (ticks > m && !__atomic_compare_exchange_n(&ph->max,&m,ticks,1,
+			__ATOMIC_RELAXED,__ATOMIC_RELAXED))
+		;
+
+	if (dump_wanted && __atomic_exchange_n(&dump_wanted,0,__ATOMIC_RELAXED))
+		des_prof_dump(stderr);
+}
+
+/* Upper bound in ticks of the bucket holding the q'th fraction of calls */
+static uint64_t prof_quantile(prof_phase *ph, double q)
+{
+	uint64_t want, n = 0;
+	int b;
+
+	want = ph->calls * q;
+	if (want < 1)
+		want = 1;
+	for (b=0;b<PROF_BUCKETS;b++)
+	{
+		n += ph->hist[b];
+		if (n >= want)
+			return b ? (1ULL << b) - 1 : 0;
+	}
+	return ph->max;
+}
+
+/* Print the counters so far. They are read without stopping other
+   threads, so a dump taken mid-run can be off by the calls in flight. */
+void des_prof_dump(FILE *fp)
+{
+	prof_phase snap[DES_PROF_PHASES], *ph;
+	double wall, rate, ms;
+	uint64_t most;
+	int p, b, bar;
+
+	memcpy(snap,phases,sizeof(snap));
+	wall = prof_ns() - start_ns;
+#ifdef DES_X86_KERNELS
+	rate = wall > 0 ? (des_prof_now() - start_ticks) / wall : 1;
+	fprintf(fp,"profile: %.3f ms wall, ticks are TSC cycles (%.2f GHz)\n",wall / 1e6,rate);
+#else
+	rate = 1;
+	fprintf(fp,"profile: %.3f ms wall, ticks are ns\n",wall / 1e6);
+#endif
+	fprintf(fp,"%-8s %12s %12s %6s %12s %12s %12s %12s\n","phase","calls","ms","%wall",
+		"mean","p50 <=","p99 <=","max");
+	for (p=0;p<DES_PROF_PHASES;p++)
+	{
+		ph = &snap[p];
+		ms = ph->ticks / rate / 1e6;
+		fprintf(fp,"%-8s %12llu %12.3f %6.1f %12.0f %12llu %12llu %12llu\n",
+			phase_names[p],(unsigned long long)ph->calls,ms,
+			wall > 0 ? 100 * ms * 1e6 / wall : 0.0,
+			ph->calls ? (double)ph->ticks / ph->calls : 0.0,
+			(unsigned long long)(ph->calls ? prof_quantile(ph,0.5) : 0),
+			(unsigned long long)(ph->calls ? prof_quantile(ph,0.99) : 0),
+			(unsigned long long)ph->max);
+	}
+
+	/* Histograms, only the buckets in use */
+	for (p=0;p<DES_PROF_PHASES;p++)
+	{
+		ph = &snap[p];
+		if (ph->calls == 0)
+			continue;
+		for (most=0,b=0;b<PROF_BUCKETS;b++)
+			if (ph->hist[b] > most)
+				most = ph->hist[b];
+		fprintf(fp,"%s, ticks per call:\n",phase_names[p]);
+		for (b=0;b<PROF_BUCKETS;b++)
+		{
+			if (ph->hist[b] == 0)
+				continue;
+			bar = (ph->hist[b] * PROF_BAR + most - 1) / most;
+			fprintf(fp,"  %12llu - %-12llu %12llu %.*s\n",
+				(unsigned long long)(b ? 1ULL << (b - 1) : 0),
+				(unsigned long long)(b ? (1ULL << b) - 1 : 0),
+				(unsigned long long)ph->hist[b],bar,
+				"########################################");
+		}
+	}
+	fflush(fp);
+}
+
+#endif	// DES_PROFILE
@@ -0,0 +1,56 @@
+/*
+ * desprof.h - Per-phase cost counters for the DES Test Program
+ *
+ * Built only with 'make PROFILE=1' (-DDES_PROFILE); otherwise every
+ * macro here expands to nothing and costs nothing.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __DESPROF_H__
+#define __DESPROF_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Phases an operation's time is charged to */
+enum {
+	DES_PROF_IO,		/* Reading input and writing files */
+	DES_PROF_PARSE,		/* Hex keys and data to binary */
+	DES_PROF_KEY,		/* Key schedules */
+	DES_PROF_CIPHER,	/* The DES rounds themselves */
+	DES_PROF_OUTPUT,	/* Binary to hex and printing it */
+	DES_PROF_PHASES
+};
+
+#ifdef DES_PROFILE
+
+#ifdef DES_X86_KERNELS
+#include <x86intrin.h>
+#define des_prof_now()	__rdtsc()
+#else
+uint64_t des_prof_now(void);
+#endif
+
+void des_prof_init(void);
+void des_prof_add(int, uint64_t);
+void des_prof_dump(FILE *);
+
+/* DES_PROF_START(t) ... DES_PROF_END(DES_PROF_KEY,t) charges the
+   ticks between them to a phase. Phases do not nest: start and end
+   a phase only around code that starts and ends no other. */
+#define DES_PROF_START(t)	uint64_t t = des_prof_now()
+#define DES_PROF_END(p, t)	des_prof_add(p, des_prof_now() - (t))
+#define DES_PROF_INIT()		des_prof_init()
+
+#else
+
+#define DES_PROF_START(t)
+#define DES_PROF_END(p, t)
+#define DES_PROF_INIT()
+
+#endif	// DES_PROFILE
+
+#endif	// __DESPROF_H__
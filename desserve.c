@@ -0,0 +1,677 @@
+/*
+ * desserve.c - Unix socket DES/TDES service for the DES Test Program
+ *
+ * des_serve() listens on a Unix stream socket and answers the requests
+ * of desserve.h until SIGINT or SIGTERM. One thread runs a poll() loop
+ * over every connection. Each pass reads whatever has arrived, parses
+ * all the complete requests into one batch (up to SRV_BATCH requests
+ * or SRV_BATCH_BYTES of data) and crypts the batch. Nothing waits for
+ * a batch to fill: a lone request goes out on the pass it came in, and
+ * requests that arrive together are crypted together.
+ *
+ * In a batch, requests are sorted by key, then by mode and direction.
+ * Each key is looked up once in a des_cache, so its schedule is built
+ * only the first time it is seen. Each run of the same key, mode and
+ * direction then becomes as few bulk calls as possible:
+ *
+ *   ECB		the data of every request in one buffer, one call
+ *   CTR		the counter blocks of every request in one buffer,
+ *			one ECB call, then XORed into each request
+ *   CBC decrypt	the ciphertexts in one buffer, one ECB call, then
+ *			each request XORed with its own chaining values
+ *   CBC encrypt	des_cbc_enc_multi(), one lane per request
+ *
+ * so many small requests under one key still reach the bitsliced
+ * kernels. With a pool, the bulk calls are also spread over threads.
+ *
+ * A client that stops reading its responses is not read from until
+ * its backlog drains below SRV_OUT_MAX.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#define _GNU_SOURCE		/* accept4() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "desutils.h"
+#include "descache.h"
+#include "desserve.h"
+
+#define SRV_BATCH	1024		/* Most requests in one batch */
+#define SRV_BATCH_BYTES	(4 << 20)	/* Most data in one batch, bar one request */
+#define SRV_READ	(256 * 1024)	/* Most read from one client per pass */
+#define SRV_OUT_MAX	(8 << 20)	/* Unsent bytes that stop reading a client */
+
+typedef struct {
+	int fd;
+	int eof;			/* Client has shut down its side */
+	int dead;			/* Error, or sent a bad frame */
+	int pending;			/* Complete requests left for next pass */
+	unsigned char *in;		/* Received, not yet answered */
+	size_t inlen, incap;
+	size_t parsed;			/* Bytes of in taken into the batch */
+	unsigned char *out;		/* Responses not yet sent */
+	size_t outlen, outcap;
+	size_t sent;
+} srv_client;
+
+typedef struct {
+	srv_client *c;
+	des_srv_req h;
+	unsigned char *key;		/* In c->in */
+	unsigned char *iv;		/* In c->in, NULL for ECB */
+	unsigned char *data;		/* In c->in, crypted in place */
+	uint32_t status;
+	int order;			/* Position in the batch as received */
+} srv_job;
+
+typedef struct {
+	union {
+		des_ctx *dc;
+		des3_ctx *d3;
+	} k;
+	int tdes;
+	des_pool *pool;
+} srv_key;
+
+static volatile sig_atomic_t srv_quit = 0;
+
+static void srv_signal(int sig)
+{
+	(void)sig;
+	srv_quit = 1;
+}
+
+/* Make room for n more bytes at *buf (len used of cap) */
+static int srv_grow(unsigned char **buf, size_t *cap, size_t len, size_t n)
+{
+	unsigned char *p;
+	size_t want;
+
+	if( len + n <= *cap )
+		return 0;
+	for( want = *cap ? *cap : 4096; want < len + n; want *= 2 )
+		;
+	p = realloc(*buf, want);
+	if( p == NULL )
+		return -1;
+	*buf = p;
+	*cap = want;
+	return 0;
+}
+
+/* ECB over blocks of buf with key k */
+static void srv_ecb(srv_key *k, int encrypt, unsigned char *buf, long blocks)
+{
+	if( k->tdes && encrypt )
+		des3_pool_enc(k->pool, k->k.d3, buf, blocks);
+	else if( k->tdes )
+		des3_pool_dec(k->pool, k->k.d3, buf, blocks);
+	else if( encrypt )
+		des_pool_enc(k->pool, k->k.dc, buf, blocks);
+	else
+		des_pool_dec(k->pool, k->k.dc, buf, blocks);
+}
+
+/* Crypt jobs j[0..n), all with the same key, mode and direction, using
+   *scratch (grown as needed) to gather them */
+static int srv_crypt(srv_key *k, srv_job **j, int n,
+		unsigned char **scratch, size_t *scap)
+{
+	unsigned char **ivs, **datas, *s, *prev;
+	int *blocks, i, b, x, encrypt;
+	long total, off;
+	uint64_t ctr;
+
+	encrypt = j[0]->h.op == DES_SRV_ENC;
+
+	if( j[0]->h.mode == DES_CBC && encrypt )
+	{
+		/* Serial per request, so one lane each */
+		ivs = malloc(n * sizeof(*ivs));
+		datas = malloc(n * sizeof(*datas));
+		blocks = malloc(n * sizeof(*blocks));
+		if( ivs == NULL || datas == NULL || blocks == NULL )
+		{
+			free(ivs);
+			free(datas);
+			free(blocks);
+			return -1;
+		}
+		for( i = 0; i < n; i++ )
+		{
+			ivs[i] = j[i]->iv;
+			datas[i] = j[i]->data;
+			blocks[i] = j[i]->h.len / 8;
+		}
+		if( k->tdes )
+			des3_cbc_enc_multi(k->k.d3, ivs, datas, blocks, n);
+		else
+			des_cbc_enc_multi(k->k.dc, ivs, datas, blocks, n);
+		free(ivs);
+		free(datas);
+		free(blocks);
+		return 0;
+	}
+
+	/* One request needs no gathering */
+	if( n == 1 && j[0]->h.mode == DES_ECB )
+	{
+		srv_ecb(k, encrypt, j[0]->data, j[0]->h.len / 8);
+		return 0;
+	}
+	if( n == 1 && j[0]->h.mode == DES_CBC && k->tdes )
+	{
+		des3_pool_cbc_dec(k->pool, k->k.d3, j[0]->iv, j[0]->data, j[0]->h.len / 8);
+		return 0;
+	}
+	if( n == 1 && j[0]->h.mode == DES_CBC )
+	{
+		des_pool_cbc_dec(k->pool, k->k.dc, j[0]->iv, j[0]->data, j[0]->h.len / 8);
+		return 0;
+	}
+	if( n == 1 && k->tdes )
+	{
+		des3_pool_ctr(k->pool, k->k.d3, j[0]->iv, j[0]->data, j[0]->h.len);
+		return 0;
+	}
+	if( n == 1 )
+	{
+		des_pool_ctr(k->pool, k->k.dc, j[0]->iv, j[0]->data, j[0]->h.len);
+		return 0;
+	}
+
+	for( total = 0, i = 0; i < n; i++ )
+		total += (j[i]->h.len + 7) / 8;
+	if( srv_grow(scratch, scap, 0, total * 8) != 0 )
+		return -1;
+	s = *scratch;
+
+	/* Gather: the data itself, or CTR counter blocks */
+	for( off = 0, i = 0; i < n; i++ )
+	{
+		if( j[i]->h.mode == DES_CTR )
+		{
+			for( ctr = 0, b = 0; b < 8; b++ )
+				ctr = (ctr << 8) | j[i]->iv[b];
+			for( b = 0; b < (int)(j[i]->h.len + 7) / 8; b++, ctr++, off += 8 )
+				for( x = 0; x < 8; x++ )
+					s[off + x] = ctr >> (56 - x * 8);
+		} else {
+			memcpy(s + off, j[i]->data, j[i]->h.len);
+			off += j[i]->h.len;
+		}
+	}
+
+	srv_ecb(k, j[0]->h.mode == DES_CTR || encrypt, s, total);
+
+	/* Scatter */
+	for( off = 0, i = 0; i < n; i++ )
+	{
+		if( j[i]->h.mode == DES_ECB )
+			memcpy(j[i]->data, s + off, j[i]->h.len);
+		else if( j[i]->h.mode == DES_CTR )
+			for( b = 0; b < (int)j[i]->h.len; b++ )
+				j[i]->data[b] ^= s[off + b];
+		else {
+			/* CBC decrypt, last block first while the
+			   ciphertext before it is still there */
+			for( b = j[i]->h.len - 8; b >= 0; b -= 8 )
+			{
+				prev = b ? j[i]->data + b - 8 : j[i]->iv;
+				memcpy(j[i]->data + b, s + off + b, 8);
+				for( x = 0; x < 8; x++ )
+					j[i]->data[b + x] ^= prev[x];
+			}
+		}
+		off += (j[i]->h.len + 7) / 8 * 8;
+	}
+	return 0;
+}
+
+/* Sort by key, then mode and direction, then arrival */
+static int srv_cmp(const void *a, const void *b)
+{
+	const srv_job *x = *(srv_job * const *)a, *y = *(srv_job * const *)b;
+	int d;
+
+	if( x->h.klen != y->h.klen )
+		return x->h.klen - y->h.klen;
+	if( (d = memcmp(x->key, y->key, x->h.klen)) != 0 )
+		return d;
+	if( x->h.mode != y->h.mode )
+		return x->h.mode - y->h.mode;
+	if( x->h.op != y->h.op )
+		return x->h.op - y->h.op;
+	return x->order - y->order;
+}
+
+/* Crypt every good job in the batch */
+static int srv_batch(srv_job *jobs, int n, des_cache *cache, des_pool *pool,
+		unsigned char **scratch, size_t *scap)
+{
+	srv_job **sorted;
+	srv_key k;
+	des_ctx dc;
+	des3_ctx d3;
+	int i, g, m, good, err = 0;
+
+	sorted = malloc(n * sizeof(*sorted));
+	if( sorted == NULL )
+		return -1;
+	for( good = 0, i = 0; i < n; i++ )
+		if( jobs[i].status == DES_SRV_OK && jobs[i].h.len > 0 )
+			sorted[good++] = &jobs[i];
+	qsort(sorted, good, sizeof(*sorted), srv_cmp);
+
+	k.pool = pool;
+	for( g = 0; g < good; g = i )
+	{
+		/* One schedule per run of the same key. The cache may
+		   evict it on the next lookup, which is the next run. */
+		for( i = g + 1; i < good && sorted[i]->h.klen == sorted[g]->h.klen &&
+		     memcmp(sorted[i]->key, sorted[g]->key, sorted[g]->h.klen) == 0; i++ )
+			;
+		k.tdes = sorted[g]->h.klen != 8;
+		if( cache != NULL && k.tdes )
+			k.k.d3 = des3_cache_key(cache, sorted[g]->key, sorted[g]->h.klen);
+		else if( cache != NULL )
+			k.k.dc = des_cache_key(cache, sorted[g]->key);
+		else if( k.tdes )
+		{
+			if( sorted[g]->h.klen == 24 )
+				des3_key3(&d3, sorted[g]->key);
+			else
+				des3_key(&d3, sorted[g]->key);
+			k.k.d3 = &d3;
+		} else {
+			des_key(&dc, sorted[g]->key);
+			k.k.dc = &dc;
+		}
+
+		for( ; g < i; g = m )
+		{
+			for( m = g + 1; m < i && sorted[m]->h.mode == sorted[g]->h.mode &&
+			     sorted[m]->h.op == sorted[g]->h.op; m++ )
+				;
+			if( srv_crypt(&k, sorted + g, m - g, scratch, scap) != 0 )
+			{
+				err = -1;
+				goto done;
+			}
+		}
+	}
+done:
+	/* Key material; a plain memset() before return may be dropped */
+	explicit_bzero(&dc, sizeof(dc));
+	explicit_bzero(&d3, sizeof(d3));
+	free(sorted);
+	return err;
+}
+
+/* Take the complete requests in c->in, from c->parsed on, into
+   jobs[*n..max) while *bytes stays under SRV_BATCH_BYTES. Sets
+   c->pending if a complete request had to be left for the next pass. */
+static void srv_parse(srv_client *c, srv_job *jobs, int *n, int max, long *bytes)
+{
+	des_srv_req h;
+	srv_job *j;
+	size_t need, ivlen;
+
+	c->pending = 0;
+	while( !c->dead )
+	{
+		if( c->inlen - c->parsed < sizeof(h) )
+			return;
+		memcpy(&h, c->in + c->parsed, sizeof(h));
+		if( h.len > DES_SRV_MAXDATA )
+		{
+			/* The framing can't be trusted past this */
+			c->dead = 1;
+			return;
+		}
+		ivlen = h.mode == DES_ECB ? 0 : 8;
+		need = sizeof(h) + h.klen + ivlen + h.len;
+		if( c->inlen - c->parsed < need )
+			return;
+		if( *n >= max || (*n > 0 && *bytes + h.len > SRV_BATCH_BYTES) )
+		{
+			c->pending = 1;
+			return;
+		}
+
+		j = &jobs[*n];
+		j->c = c;
+		j->h = h;
+		j->key = c->in + c->parsed + sizeof(h);
+		j->iv = ivlen ? j->key + h.klen : NULL;
+		j->data = j->key + h.klen + ivlen;
+		j->order = *n;
+		if( h.klen != 8 && h.klen != 16 && h.klen != 24 )
+			j->status = DES_SRV_EKEY;
+		else if( h.op > DES_SRV_ENC || h.mode > DES_CTR || h.flags != 0 )
+			j->status = DES_SRV_EOP;
+		else if( h.mode != DES_CTR && h.len % 8 != 0 )
+			j->status = DES_SRV_ELEN;
+		else
+			j->status = DES_SRV_OK;
+		c->parsed += need;
+		*bytes += h.len;
+		(*n)++;
+	}
+}
+
+/* Send what c has queued, without blocking */
+static void srv_flush(srv_client *c)
+{
+	ssize_t w;
+
+	while( c->sent < c->outlen && !c->dead )
+	{
+		w = send(c->fd, c->out + c->sent, c->outlen - c->sent, MSG_NOSIGNAL);
+		if( w < 0 && errno == EINTR )
+			continue;
+		if( w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+			break;
+		if( w <= 0 )
+		{
+			c->dead = 1;
+			break;
+		}
+		c->sent += w;
+	}
+	if( c->sent == c->outlen )
+		c->sent = c->outlen = 0;
+}
+
+/* Read what has arrived on c, up to SRV_READ bytes */
+static void srv_read(srv_client *c)
+{
+	ssize_t r;
+	size_t got = 0;
+
+	while( got < SRV_READ )
+	{
+		if( srv_grow(&c->in, &c->incap, c->inlen, 65536) != 0 )
+		{
+			c->dead = 1;
+			return;
+		}
+		r = recv(c->fd, c->in + c->inlen, c->incap - c->inlen, 0);
+		if( r < 0 && errno == EINTR )
+			continue;
+		if( r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+			return;
+		if( r == 0 )
+		{
+			/* Still answer what it sent, then close */
+			c->eof = 1;
+			return;
+		}
+		if( r < 0 )
+		{
+			c->dead = 1;
+			return;
+		}
+		c->inlen += r;
+		got += r;
+	}
+}
+
+/* Open and listen on path, replacing a stale socket left there */
+static int srv_listen(const char *path)
+{
+	struct sockaddr_un sa;
+	struct stat st;
+	int fd;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if( strlen(path) >= sizeof(sa.sun_path) )
+	{
+		fprintf(stderr, "%s: socket path too long\n", path);
+		return -1;
+	}
+	strcpy(sa.sun_path, path);
+
+	/* A socket left by a service that died can be replaced, but not
+	   one a running service still listens on */
+	if( lstat(path, &st) == 0 && S_ISSOCK(st.st_mode) )
+	{
+		fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if( fd < 0 )
+		{
+			perror(path);
+			return -1;
+		}
+		if( connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0 )
+		{
+			fprintf(stderr, "%s: already being served\n", path);
+			close(fd);
+			return -1;
+		}
+		if( errno == ECONNREFUSED )
+			unlink(path);
+		close(fd);
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if( fd < 0 || bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0 ||
+	    listen(fd, SOMAXCONN) != 0 )
+	{
+		perror(path);
+		if( fd >= 0 )
+			close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* Serve requests on the Unix socket path until SIGINT or SIGTERM.
+ * pool (may be NULL) runs the bulk calls, cachesize schedules are kept
+ * (0 for none) and with stats set the counters go to stderr at the
+ * end. Returns the exit status.
+ */
+int des_serve(const char *path, des_pool *pool, int cachesize, int stats)
+{
+	struct sigaction sa;
+	struct pollfd *pfd = NULL, *np;
+	srv_client *cl = NULL, *nc;
+	srv_job *jobs;
+	des_cache *cache = NULL;
+	des_cache_stats cs;
+	des_srv_resp r;
+	unsigned char *scratch = NULL;
+	size_t scap = 0;
+	unsigned long requests = 0, batches = 0, bytes = 0;
+	long batchbytes;
+	int lfd, fd, ncl = 0, clcap = 0, i, k, n, more = 0, first = 0, err = 0;
+
+	lfd = srv_listen(path);
+	if( lfd < 0 )
+		return 1;
+	jobs = malloc(SRV_BATCH * sizeof(*jobs));
+	if( cachesize > 0 )
+		cache = des_cache_create(cachesize);
+	if( jobs == NULL || (cachesize > 0 && cache == NULL) )
+	{
+		fprintf(stderr, "out of memory!\n");
+		close(lfd);
+		unlink(path);
+		return 1;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = srv_signal;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	while( !srv_quit && !err )
+	{
+		/* Room for the listener and every client */
+		if( clcap < ncl + 1 )
+		{
+			np = realloc(pfd, ((ncl + 1) * 2 + 1) * sizeof(*pfd));
+			if( np != NULL )
+				pfd = np;
+			nc = realloc(cl, (ncl + 1) * 2 * sizeof(*cl));
+			if( nc != NULL )
+				cl = nc;
+			if( np == NULL || nc == NULL )
+			{
+				fprintf(stderr, "out of memory!\n");
+				err = 1;
+				break;
+			}
+			clcap = (ncl + 1) * 2;
+		}
+		pfd[0].fd = lfd;
+		pfd[0].events = POLLIN;
+		for( i = 0; i < ncl; i++ )
+		{
+			pfd[i + 1].fd = cl[i].fd;
+			pfd[i + 1].events = 0;
+			if( !cl[i].eof && cl[i].outlen - cl[i].sent < SRV_OUT_MAX )
+				pfd[i + 1].events |= POLLIN;
+			if( cl[i].outlen > cl[i].sent )
+				pfd[i + 1].events |= POLLOUT;
+		}
+
+		/* Don't sleep while requests from a full batch are waiting */
+		if( poll(pfd, ncl + 1, more ? 0 : -1) < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+			perror("poll");
+			err = 1;
+			break;
+		}
+
+		n = ncl;
+		for( i = 0; i < n; i++ )
+		{
+			if( pfd[i + 1].revents & (POLLIN | POLLHUP | POLLERR) )
+				srv_read(&cl[i]);
+			if( pfd[i + 1].revents & POLLOUT )
+				srv_flush(&cl[i]);
+		}
+
+		/* Batch what is complete, starting from a different client
+		   each pass so none can crowd out the rest */
+		k = 0;
+		batchbytes = 0;
+		more = 0;
+		for( i = 0; i < ncl; i++ )
+		{
+			srv_parse(&cl[(first + i) % ncl], jobs, &k, SRV_BATCH, &batchbytes);
+			more |= cl[(first + i) % ncl].pending;
+		}
+		if( ncl > 0 )
+			first = (first + 1) % ncl;
+		if( k > 0 )
+		{
+			if( srv_batch(jobs, k, cache, pool, &scratch, &scap) != 0 )
+			{
+				fprintf(stderr, "out of memory!\n");
+				err = 1;
+				break;
+			}
+			requests += k;
+			batches++;
+			bytes += batchbytes;
+		}
+
+		/* Answer in arrival order, then drop what was answered */
+		for( i = 0; i < k; i++ )
+		{
+			r.id = jobs[i].h.id;
+			r.status = jobs[i].status;
+			r.len = r.status == DES_SRV_OK ? jobs[i].h.len : 0;
+			if( srv_grow(&jobs[i].c->out, &jobs[i].c->outcap,
+				     jobs[i].c->outlen, sizeof(r) + r.len) != 0 )
+			{
+				jobs[i].c->dead = 1;
+				continue;
+			}
+			memcpy(jobs[i].c->out + jobs[i].c->outlen, &r, sizeof(r));
+			memcpy(jobs[i].c->out + jobs[i].c->outlen + sizeof(r), jobs[i].data, r.len);
+			jobs[i].c->outlen += sizeof(r) + r.len;
+		}
+		for( i = 0; i < ncl; i++ )
+		{
+			if( cl[i].parsed > 0 )
+			{
+				memmove(cl[i].in, cl[i].in + cl[i].parsed, cl[i].inlen - cl[i].parsed);
+				cl[i].inlen -= cl[i].parsed;
+				cl[i].parsed = 0;
+			}
+			srv_flush(&cl[i]);
+		}
+
+		/* Close the dead, and those that have shut down and have
+		   been answered, keeping the array packed */
+		for( i = 0; i < ncl; )
+		{
+			if( !cl[i].dead && !(cl[i].eof && !cl[i].pending && cl[i].outlen == 0) )
+			{
+				i++;
+				continue;
+			}
+			close(cl[i].fd);
+			free(cl[i].in);
+			free(cl[i].out);
+			cl[i] = cl[--ncl];
+		}
+
+		/* New connections go on the end, next pass */
+		if( pfd[0].revents & POLLIN )
+		{
+			/* Any more wait for the arrays to grow */
+			while( ncl < clcap &&
+			       (fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0 )
+			{
+				memset(&cl[ncl], 0, sizeof(cl[ncl]));
+				cl[ncl++].fd = fd;
+			}
+		}
+	}
+
+	if( stats )
+	{
+		fprintf(stderr, "serve: %lu requests in %lu batches (%.1f per batch), %lu bytes\n",
+			requests, batches, batches ? (double)requests / batches : 0.0, bytes);
+		if( cache != NULL )
+		{
+			des_cache_get_stats(cache, &cs);
+			fprintf(stderr, "key cache: %lu hits, %lu misses, %lu evictions, %d/%d entries\n",
+				cs.hits, cs.misses, cs.evictions, cs.entries, cs.size);
+		}
+	}
+
+	for( i = 0; i < ncl; i++ )
+	{
+		close(cl[i].fd);
+		free(cl[i].in);
+		free(cl[i].out);
+	}
+	close(lfd);
+	unlink(path);
+	des_cache_destroy(cache);
+	if( scratch != NULL )
+		explicit_bzero(scratch, scap);
+	free(scratch);
+	free(jobs);
+	free(cl);
+	free(pfd);
+	return err;
+}
@@ -0,0 +1,55 @@
+/*
+ * desserve.h - Unix socket DES/TDES service for the DES Test Program
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __DESSERVE_H__
+#define __DESSERVE_H__
+
+#include <stdint.h>
+#include "despool.h"
+#include "desfile.h"
+
+/* Protocol. A client sends requests and reads responses on a stream
+ * socket, in native byte order. A request is a des_srv_req, then klen
+ * key bytes, then for any mode but DES_ECB the 8 byte IV or first
+ * counter block, then len bytes of data. Each request gets one des_srv_resp
+ * with the same id, followed on success by len bytes of result.
+ * Responses on a connection come back in request order, so a client
+ * may send several requests before reading.
+ */
+#define DES_SRV_MAXDATA	(1024 * 1024)	/* Largest len; above it the
+					   connection is closed */
+
+enum {
+	DES_SRV_DEC,
+	DES_SRV_ENC
+};
+
+/* Response status */
+#define DES_SRV_OK	0
+#define DES_SRV_EKEY	1	/* klen not 8 (DES), 16 or 24 (TDES) */
+#define DES_SRV_EOP	2	/* Unknown op or mode, or flags not 0 */
+#define DES_SRV_ELEN	3	/* ECB or CBC data not whole blocks */
+
+typedef struct {
+	uint32_t id;		/* Anything; echoed in the response */
+	uint32_t len;		/* Data bytes */
+	uint8_t op;		/* DES_SRV_ENC or DES_SRV_DEC */
+	uint8_t mode;		/* DES_ECB, DES_CBC or DES_CTR */
+	uint8_t klen;		/* Key bytes, which also picks DES or TDES */
+	uint8_t flags;		/* 0 */
+} des_srv_req;
+
+typedef struct {
+	uint32_t id;
+	uint32_t status;	/* DES_SRV_OK or DES_SRV_E* */
+	uint32_t len;		/* Result bytes that follow */
+} des_srv_resp;
+
+int des_serve(const char *, des_pool *, int, int);
+
+#endif	// __DESSERVE_H__
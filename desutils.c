@@ -11,7 +11,539 @@
  */
 
 #include <stdio.h>
-#include "desutils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "libdesutils.h"
+#include "desbs.h"
+#include "desprof.h"
+#include "desprobe.h"
+
+/* The tables of the Standard and the prototypes of this module's
+ * static functions live here rather than in desutils.h, so that each
+ * file including the header does not get its own copy.
+ */
+
+static unsigned char totrot[16] = {
+	1,2,4,6,8,10,12,14,15,17,19,21,23,25,27,28 };
+
+/* The key schedule specified in the Standard (ANSI X3.92-1981), as the
+ * original bit-at-a-time deskey() used it:
+ *
+ * pc1[56] = {
+ *	56, 48, 40, 32, 24, 16,  8,  0, 57, 49, 41, 33, 25, 17,
+ *	 9,  1, 58, 50, 42, 34, 26, 18, 10,  2, 59, 51, 43, 35,
+ *	62, 54, 46, 38, 30, 22, 14,  6, 61, 53, 45, 37, 29, 21,
+ *	13,  5, 60, 52, 44, 36, 28, 20, 12,  4, 27, 19, 11,  3 };
+ *
+ * pc2[48] = {
+ *	13, 16, 10, 23,  0,  4,  2, 27, 14,  5, 20,  9,
+ *	22, 18, 11,  3, 25,  7, 15,  6, 26, 19, 12,  1,
+ *	40, 51, 30, 36, 46, 54, 29, 39, 50, 44, 32, 47,
+ *	43, 48, 38, 55, 33, 52, 45, 41, 49, 35, 28, 31 };
+ *
+ * totrot[] above is the cumulative left shift of C and D per round.
+ */
+
+/* Table-driven form of the same schedule, used by rawkey(). pc1c/pc1d
+ * give the contribution of each key nibble (MSB first) to the 28-bit C
+ * and D registers. pc2c/pc2d give the contribution of each 7-bit chunk
+ * of the rotated C and D registers to the two 24-bit raw subkey halves.
+ * These are pc1[] and pc2[] above, tabulated.
+ */
+static uint32_t pc1c[16][16] DES_ALIGN = {
+	{
+	0x0000000L, 0x0000000L, 0x0000010L, 0x0000010L, 0x0001000L, 0x0001000L, 0x0001010L, 0x0001010L,
+	0x0100000L, 0x0100000L, 0x0100010L, 0x0100010L, 0x0101000L, 0x0101000L, 0x0101010L, 0x0101010L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000000L, 0x0000020L, 0x0000020L, 0x0002000L, 0x0002000L, 0x0002020L, 0x0002020L,
+	0x0200000L, 0x0200000L, 0x0200020L, 0x0200020L, 0x0202000L, 0x0202000L, 0x0202020L, 0x0202020L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000000L, 0x0000040L, 0x0000040L, 0x0004000L, 0x0004000L, 0x0004040L, 0x0004040L,
+	0x0400000L, 0x0400000L, 0x0400040L, 0x0400040L, 0x0404000L, 0x0404000L, 0x0404040L, 0x0404040L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000000L, 0x0000080L, 0x0000080L, 0x0008000L, 0x0008000L, 0x0008080L, 0x0008080L,
+	0x0800000L, 0x0800000L, 0x0800080L, 0x0800080L, 0x0808000L, 0x0808000L, 0x0808080L, 0x0808080L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000001L, 0x0000100L, 0x0000101L, 0x0010000L, 0x0010001L, 0x0010100L, 0x0010101L,
+	0x1000000L, 0x1000001L, 0x1000100L, 0x1000101L, 0x1010000L, 0x1010001L, 0x1010100L, 0x1010101L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000002L, 0x0000200L, 0x0000202L, 0x0020000L, 0x0020002L, 0x0020200L, 0x0020202L,
+	0x2000000L, 0x2000002L, 0x2000200L, 0x2000202L, 0x2020000L, 0x2020002L, 0x2020200L, 0x2020202L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000004L, 0x0000400L, 0x0000404L, 0x0040000L, 0x0040004L, 0x0040400L, 0x0040404L,
+	0x4000000L, 0x4000004L, 0x4000400L, 0x4000404L, 0x4040000L, 0x4040004L, 0x4040400L, 0x4040404L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000008L, 0x0000800L, 0x0000808L, 0x0080000L, 0x0080008L, 0x0080800L, 0x0080808L,
+	0x8000000L, 0x8000008L, 0x8000800L, 0x8000808L, 0x8080000L, 0x8080008L, 0x8080800L, 0x8080808L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L } };
+
+static uint32_t pc1d[16][16] DES_ALIGN = {
+	{
+	0x0000000L, 0x0000001L, 0x0000000L, 0x0000001L, 0x0000000L, 0x0000001L, 0x0000000L, 0x0000001L,
+	0x0000000L, 0x0000001L, 0x0000000L, 0x0000001L, 0x0000000L, 0x0000001L, 0x0000000L, 0x0000001L }, {
+	0x0000000L, 0x0000000L, 0x0100000L, 0x0100000L, 0x0001000L, 0x0001000L, 0x0101000L, 0x0101000L,
+	0x0000010L, 0x0000010L, 0x0100010L, 0x0100010L, 0x0001010L, 0x0001010L, 0x0101010L, 0x0101010L }, {
+	0x0000000L, 0x0000002L, 0x0000000L, 0x0000002L, 0x0000000L, 0x0000002L, 0x0000000L, 0x0000002L,
+	0x0000000L, 0x0000002L, 0x0000000L, 0x0000002L, 0x0000000L, 0x0000002L, 0x0000000L, 0x0000002L }, {
+	0x0000000L, 0x0000000L, 0x0200000L, 0x0200000L, 0x0002000L, 0x0002000L, 0x0202000L, 0x0202000L,
+	0x0000020L, 0x0000020L, 0x0200020L, 0x0200020L, 0x0002020L, 0x0002020L, 0x0202020L, 0x0202020L }, {
+	0x0000000L, 0x0000004L, 0x0000000L, 0x0000004L, 0x0000000L, 0x0000004L, 0x0000000L, 0x0000004L,
+	0x0000000L, 0x0000004L, 0x0000000L, 0x0000004L, 0x0000000L, 0x0000004L, 0x0000000L, 0x0000004L }, {
+	0x0000000L, 0x0000000L, 0x0400000L, 0x0400000L, 0x0004000L, 0x0004000L, 0x0404000L, 0x0404000L,
+	0x0000040L, 0x0000040L, 0x0400040L, 0x0400040L, 0x0004040L, 0x0004040L, 0x0404040L, 0x0404040L }, {
+	0x0000000L, 0x0000008L, 0x0000000L, 0x0000008L, 0x0000000L, 0x0000008L, 0x0000000L, 0x0000008L,
+	0x0000000L, 0x0000008L, 0x0000000L, 0x0000008L, 0x0000000L, 0x0000008L, 0x0000000L, 0x0000008L }, {
+	0x0000000L, 0x0000000L, 0x0800000L, 0x0800000L, 0x0008000L, 0x0008000L, 0x0808000L, 0x0808000L,
+	0x0000080L, 0x0000080L, 0x0800080L, 0x0800080L, 0x0008080L, 0x0008080L, 0x0808080L, 0x0808080L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000000L, 0x1000000L, 0x1000000L, 0x0010000L, 0x0010000L, 0x1010000L, 0x1010000L,
+	0x0000100L, 0x0000100L, 0x1000100L, 0x1000100L, 0x0010100L, 0x0010100L, 0x1010100L, 0x1010100L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000000L, 0x2000000L, 0x2000000L, 0x0020000L, 0x0020000L, 0x2020000L, 0x2020000L,
+	0x0000200L, 0x0000200L, 0x2000200L, 0x2000200L, 0x0020200L, 0x0020200L, 0x2020200L, 0x2020200L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000000L, 0x4000000L, 0x4000000L, 0x0040000L, 0x0040000L, 0x4040000L, 0x4040000L,
+	0x0000400L, 0x0000400L, 0x4000400L, 0x4000400L, 0x0040400L, 0x0040400L, 0x4040400L, 0x4040400L }, {
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L,
+	0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L, 0x0000000L }, {
+	0x0000000L, 0x0000000L, 0x8000000L, 0x8000000L, 0x0080000L, 0x0080000L, 0x8080000L, 0x8080000L,
+	0x0000800L, 0x0000800L, 0x8000800L, 0x8000800L, 0x0080800L, 0x0080800L, 0x8080800L, 0x8080800L } };
+
+static uint32_t pc2c[4][128] DES_ALIGN = {
+	{
+	0x0000000L, 0x0000010L, 0x0004000L, 0x0004010L, 0x0040000L, 0x0040010L, 0x0044000L, 0x0044010L,
+	0x0000100L, 0x0000110L, 0x0004100L, 0x0004110L, 0x0040100L, 0x0040110L, 0x0044100L, 0x0044110L,
+	0x0020000L, 0x0020010L, 0x0024000L, 0x0024010L, 0x0060000L, 0x0060010L, 0x0064000L, 0x0064010L,
+	0x0020100L, 0x0020110L, 0x0024100L, 0x0024110L, 0x0060100L, 0x0060110L, 0x0064100L, 0x0064110L,
+	0x0000001L, 0x0000011L, 0x0004001L, 0x0004011L, 0x0040001L, 0x0040011L, 0x0044001L, 0x0044011L,
+	0x0000101L, 0x0000111L, 0x0004101L, 0x0004111L, 0x0040101L, 0x0040111L, 0x0044101L, 0x0044111L,
+	0x0020001L, 0x0020011L, 0x0024001L, 0x0024011L, 0x0060001L, 0x0060011L, 0x0064001L, 0x0064011L,
+	0x0020101L, 0x0020111L, 0x0024101L, 0x0024111L, 0x0060101L, 0x0060111L, 0x0064101L, 0x0064111L,
+	0x0080000L, 0x0080010L, 0x0084000L, 0x0084010L, 0x00c0000L, 0x00c0010L, 0x00c4000L, 0x00c4010L,
+	0x0080100L, 0x0080110L, 0x0084100L, 0x0084110L, 0x00c0100L, 0x00c0110L, 0x00c4100L, 0x00c4110L,
+	0x00a0000L, 0x00a0010L, 0x00a4000L, 0x00a4010L, 0x00e0000L, 0x00e0010L, 0x00e4000L, 0x00e4010L,
+	0x00a0100L, 0x00a0110L, 0x00a4100L, 0x00a4110L, 0x00e0100L, 0x00e0110L, 0x00e4100L, 0x00e4110L,
+	0x0080001L, 0x0080011L, 0x0084001L, 0x0084011L, 0x00c0001L, 0x00c0011L, 0x00c4001L, 0x00c4011L,
+	0x0080101L, 0x0080111L, 0x0084101L, 0x0084111L, 0x00c0101L, 0x00c0111L, 0x00c4101L, 0x00c4111L,
+	0x00a0001L, 0x00a0011L, 0x00a4001L, 0x00a4011L, 0x00e0001L, 0x00e0011L, 0x00e4001L, 0x00e4011L,
+	0x00a0101L, 0x00a0111L, 0x00a4101L, 0x00a4111L, 0x00e0101L, 0x00e0111L, 0x00e4101L, 0x00e4111L }, {
+	0x0000000L, 0x0800000L, 0x0000002L, 0x0800002L, 0x0000200L, 0x0800200L, 0x0000202L, 0x0800202L,
+	0x0200000L, 0x0a00000L, 0x0200002L, 0x0a00002L, 0x0200200L, 0x0a00200L, 0x0200202L, 0x0a00202L,
+	0x0001000L, 0x0801000L, 0x0001002L, 0x0801002L, 0x0001200L, 0x0801200L, 0x0001202L, 0x0801202L,
+	0x0201000L, 0x0a01000L, 0x0201002L, 0x0a01002L, 0x0201200L, 0x0a01200L, 0x0201202L, 0x0a01202L,
+	0x0000000L, 0x0800000L, 0x0000002L, 0x0800002L, 0x0000200L, 0x0800200L, 0x0000202L, 0x0800202L,
+	0x0200000L, 0x0a00000L, 0x0200002L, 0x0a00002L, 0x0200200L, 0x0a00200L, 0x0200202L, 0x0a00202L,
+	0x0001000L, 0x0801000L, 0x0001002L, 0x0801002L, 0x0001200L, 0x0801200L, 0x0001202L, 0x0801202L,
+	0x0201000L, 0x0a01000L, 0x0201002L, 0x0a01002L, 0x0201200L, 0x0a01200L, 0x0201202L, 0x0a01202L,
+	0x0000040L, 0x0800040L, 0x0000042L, 0x0800042L, 0x0000240L, 0x0800240L, 0x0000242L, 0x0800242L,
+	0x0200040L, 0x0a00040L, 0x0200042L, 0x0a00042L, 0x0200240L, 0x0a00240L, 0x0200242L, 0x0a00242L,
+	0x0001040L, 0x0801040L, 0x0001042L, 0x0801042L, 0x0001240L, 0x0801240L, 0x0001242L, 0x0801242L,
+	0x0201040L, 0x0a01040L, 0x0201042L, 0x0a01042L, 0x0201240L, 0x0a01240L, 0x0201242L, 0x0a01242L,
+	0x0000040L, 0x0800040L, 0x0000042L, 0x0800042L, 0x0000240L, 0x0800240L, 0x0000242L, 0x0800242L,
+	0x0200040L, 0x0a00040L, 0x0200042L, 0x0a00042L, 0x0200240L, 0x0a00240L, 0x0200242L, 0x0a00242L,
+	0x0001040L, 0x0801040L, 0x0001042L, 0x0801042L, 0x0001240L, 0x0801240L, 0x0001242L, 0x0801242L,
+	0x0201040L, 0x0a01040L, 0x0201042L, 0x0a01042L, 0x0201240L, 0x0a01240L, 0x0201242L, 0x0a01242L }, {
+	0x0000000L, 0x0002000L, 0x0000004L, 0x0002004L, 0x0000400L, 0x0002400L, 0x0000404L, 0x0002404L,
+	0x0000000L, 0x0002000L, 0x0000004L, 0x0002004L, 0x0000400L, 0x0002400L, 0x0000404L, 0x0002404L,
+	0x0400000L, 0x0402000L, 0x0400004L, 0x0402004L, 0x0400400L, 0x0402400L, 0x0400404L, 0x0402404L,
+	0x0400000L, 0x0402000L, 0x0400004L, 0x0402004L, 0x0400400L, 0x0402400L, 0x0400404L, 0x0402404L,
+	0x0000020L, 0x0002020L, 0x0000024L, 0x0002024L, 0x0000420L, 0x0002420L, 0x0000424L, 0x0002424L,
+	0x0000020L, 0x0002020L, 0x0000024L, 0x0002024L, 0x0000420L, 0x0002420L, 0x0000424L, 0x0002424L,
+	0x0400020L, 0x0402020L, 0x0400024L, 0x0402024L, 0x0400420L, 0x0402420L, 0x0400424L, 0x0402424L,
+	0x0400020L, 0x0402020L, 0x0400024L, 0x0402024L, 0x0400420L, 0x0402420L, 0x0400424L, 0x0402424L,
+	0x0008000L, 0x000a000L, 0x0008004L, 0x000a004L, 0x0008400L, 0x000a400L, 0x0008404L, 0x000a404L,
+	0x0008000L, 0x000a000L, 0x0008004L, 0x000a004L, 0x0008400L, 0x000a400L, 0x0008404L, 0x000a404L,
+	0x0408000L, 0x040a000L, 0x0408004L, 0x040a004L, 0x0408400L, 0x040a400L, 0x0408404L, 0x040a404L,
+	0x0408000L, 0x040a000L, 0x0408004L, 0x040a004L, 0x0408400L, 0x040a400L, 0x0408404L, 0x040a404L,
+	0x0008020L, 0x000a020L, 0x0008024L, 0x000a024L, 0x0008420L, 0x000a420L, 0x0008424L, 0x000a424L,
+	0x0008020L, 0x000a020L, 0x0008024L, 0x000a024L, 0x0008420L, 0x000a420L, 0x0008424L, 0x000a424L,
+	0x0408020L, 0x040a020L, 0x0408024L, 0x040a024L, 0x0408420L, 0x040a420L, 0x0408424L, 0x040a424L,
+	0x0408020L, 0x040a020L, 0x0408024L, 0x040a024L, 0x0408420L, 0x040a420L, 0x0408424L, 0x040a424L }, {
+	0x0000000L, 0x0010000L, 0x0000008L, 0x0010008L, 0x0000080L, 0x0010080L, 0x0000088L, 0x0010088L,
+	0x0000000L, 0x0010000L, 0x0000008L, 0x0010008L, 0x0000080L, 0x0010080L, 0x0000088L, 0x0010088L,
+	0x0100000L, 0x0110000L, 0x0100008L, 0x0110008L, 0x0100080L, 0x0110080L, 0x0100088L, 0x0110088L,
+	0x0100000L, 0x0110000L, 0x0100008L, 0x0110008L, 0x0100080L, 0x0110080L, 0x0100088L, 0x0110088L,
+	0x0000800L, 0x0010800L, 0x0000808L, 0x0010808L, 0x0000880L, 0x0010880L, 0x0000888L, 0x0010888L,
+	0x0000800L, 0x0010800L, 0x0000808L, 0x0010808L, 0x0000880L, 0x0010880L, 0x0000888L, 0x0010888L,
+	0x0100800L, 0x0110800L, 0x0100808L, 0x0110808L, 0x0100880L, 0x0110880L, 0x0100888L, 0x0110888L,
+	0x0100800L, 0x0110800L, 0x0100808L, 0x0110808L, 0x0100880L, 0x0110880L, 0x0100888L, 0x0110888L,
+	0x0000000L, 0x0010000L, 0x0000008L, 0x0010008L, 0x0000080L, 0x0010080L, 0x0000088L, 0x0010088L,
+	0x0000000L, 0x0010000L, 0x0000008L, 0x0010008L, 0x0000080L, 0x0010080L, 0x0000088L, 0x0010088L,
+	0x0100000L, 0x0110000L, 0x0100008L, 0x0110008L, 0x0100080L, 0x0110080L, 0x0100088L, 0x0110088L,
+	0x0100000L, 0x0110000L, 0x0100008L, 0x0110008L, 0x0100080L, 0x0110080L, 0x0100088L, 0x0110088L,
+	0x0000800L, 0x0010800L, 0x0000808L, 0x0010808L, 0x0000880L, 0x0010880L, 0x0000888L, 0x0010888L,
+	0x0000800L, 0x0010800L, 0x0000808L, 0x0010808L, 0x0000880L, 0x0010880L, 0x0000888L, 0x0010888L,
+	0x0100800L, 0x0110800L, 0x0100808L, 0x0110808L, 0x0100880L, 0x0110880L, 0x0100888L, 0x0110888L,
+	0x0100800L, 0x0110800L, 0x0100808L, 0x0110808L, 0x0100880L, 0x0110880L, 0x0100888L, 0x0110888L } };
+
+static uint32_t pc2d[4][128] DES_ALIGN = {
+	{
+	0x0000000L, 0x0000000L, 0x0000080L, 0x0000080L, 0x0002000L, 0x0002000L, 0x0002080L, 0x0002080L,
+	0x0000001L, 0x0000001L, 0x0000081L, 0x0000081L, 0x0002001L, 0x0002001L, 0x0002081L, 0x0002081L,
+	0x0200000L, 0x0200000L, 0x0200080L, 0x0200080L, 0x0202000L, 0x0202000L, 0x0202080L, 0x0202080L,
+	0x0200001L, 0x0200001L, 0x0200081L, 0x0200081L, 0x0202001L, 0x0202001L, 0x0202081L, 0x0202081L,
+	0x0020000L, 0x0020000L, 0x0020080L, 0x0020080L, 0x0022000L, 0x0022000L, 0x0022080L, 0x0022080L,
+	0x0020001L, 0x0020001L, 0x0020081L, 0x0020081L, 0x0022001L, 0x0022001L, 0x0022081L, 0x0022081L,
+	0x0220000L, 0x0220000L, 0x0220080L, 0x0220080L, 0x0222000L, 0x0222000L, 0x0222080L, 0x0222080L,
+	0x0220001L, 0x0220001L, 0x0220081L, 0x0220081L, 0x0222001L, 0x0222001L, 0x0222081L, 0x0222081L,
+	0x0000002L, 0x0000002L, 0x0000082L, 0x0000082L, 0x0002002L, 0x0002002L, 0x0002082L, 0x0002082L,
+	0x0000003L, 0x0000003L, 0x0000083L, 0x0000083L, 0x0002003L, 0x0002003L, 0x0002083L, 0x0002083L,
+	0x0200002L, 0x0200002L, 0x0200082L, 0x0200082L, 0x0202002L, 0x0202002L, 0x0202082L, 0x0202082L,
+	0x0200003L, 0x0200003L, 0x0200083L, 0x0200083L, 0x0202003L, 0x0202003L, 0x0202083L, 0x0202083L,
+	0x0020002L, 0x0020002L, 0x0020082L, 0x0020082L, 0x0022002L, 0x0022002L, 0x0022082L, 0x0022082L,
+	0x0020003L, 0x0020003L, 0x0020083L, 0x0020083L, 0x0022003L, 0x0022003L, 0x0022083L, 0x0022083L,
+	0x0220002L, 0x0220002L, 0x0220082L, 0x0220082L, 0x0222002L, 0x0222002L, 0x0222082L, 0x0222082L,
+	0x0220003L, 0x0220003L, 0x0220083L, 0x0220083L, 0x0222003L, 0x0222003L, 0x0222083L, 0x0222083L }, {
+	0x0000000L, 0x0000010L, 0x0800000L, 0x0800010L, 0x0010000L, 0x0010010L, 0x0810000L, 0x0810010L,
+	0x0000200L, 0x0000210L, 0x0800200L, 0x0800210L, 0x0010200L, 0x0010210L, 0x0810200L, 0x0810210L,
+	0x0000000L, 0x0000010L, 0x0800000L, 0x0800010L, 0x0010000L, 0x0010010L, 0x0810000L, 0x0810010L,
+	0x0000200L, 0x0000210L, 0x0800200L, 0x0800210L, 0x0010200L, 0x0010210L, 0x0810200L, 0x0810210L,
+	0x0100000L, 0x0100010L, 0x0900000L, 0x0900010L, 0x0110000L, 0x0110010L, 0x0910000L, 0x0910010L,
+	0x0100200L, 0x0100210L, 0x0900200L, 0x0900210L, 0x0110200L, 0x0110210L, 0x0910200L, 0x0910210L,
+	0x0100000L, 0x0100010L, 0x0900000L, 0x0900010L, 0x0110000L, 0x0110010L, 0x0910000L, 0x0910010L,
+	0x0100200L, 0x0100210L, 0x0900200L, 0x0900210L, 0x0110200L, 0x0110210L, 0x0910200L, 0x0910210L,
+	0x0000004L, 0x0000014L, 0x0800004L, 0x0800014L, 0x0010004L, 0x0010014L, 0x0810004L, 0x0810014L,
+	0x0000204L, 0x0000214L, 0x0800204L, 0x0800214L, 0x0010204L, 0x0010214L, 0x0810204L, 0x0810214L,
+	0x0000004L, 0x0000014L, 0x0800004L, 0x0800014L, 0x0010004L, 0x0010014L, 0x0810004L, 0x0810014L,
+	0x0000204L, 0x0000214L, 0x0800204L, 0x0800214L, 0x0010204L, 0x0010214L, 0x0810204L, 0x0810214L,
+	0x0100004L, 0x0100014L, 0x0900004L, 0x0900014L, 0x0110004L, 0x0110014L, 0x0910004L, 0x0910014L,
+	0x0100204L, 0x0100214L, 0x0900204L, 0x0900214L, 0x0110204L, 0x0110214L, 0x0910204L, 0x0910214L,
+	0x0100004L, 0x0100014L, 0x0900004L, 0x0900014L, 0x0110004L, 0x0110014L, 0x0910004L, 0x0910014L,
+	0x0100204L, 0x0100214L, 0x0900204L, 0x0900214L, 0x0110204L, 0x0110214L, 0x0910204L, 0x0910214L }, {
+	0x0000000L, 0x0000400L, 0x0001000L, 0x0001400L, 0x0080000L, 0x0080400L, 0x0081000L, 0x0081400L,
+	0x0000020L, 0x0000420L, 0x0001020L, 0x0001420L, 0x0080020L, 0x0080420L, 0x0081020L, 0x0081420L,
+	0x0004000L, 0x0004400L, 0x0005000L, 0x0005400L, 0x0084000L, 0x0084400L, 0x0085000L, 0x0085400L,
+	0x0004020L, 0x0004420L, 0x0005020L, 0x0005420L, 0x0084020L, 0x0084420L, 0x0085020L, 0x0085420L,
+	0x0000800L, 0x0000c00L, 0x0001800L, 0x0001c00L, 0x0080800L, 0x0080c00L, 0x0081800L, 0x0081c00L,
+	0x0000820L, 0x0000c20L, 0x0001820L, 0x0001c20L, 0x0080820L, 0x0080c20L, 0x0081820L, 0x0081c20L,
+	0x0004800L, 0x0004c00L, 0x0005800L, 0x0005c00L, 0x0084800L, 0x0084c00L, 0x0085800L, 0x0085c00L,
+	0x0004820L, 0x0004c20L, 0x0005820L, 0x0005c20L, 0x0084820L, 0x0084c20L, 0x0085820L, 0x0085c20L,
+	0x0000000L, 0x0000400L, 0x0001000L, 0x0001400L, 0x0080000L, 0x0080400L, 0x0081000L, 0x0081400L,
+	0x0000020L, 0x0000420L, 0x0001020L, 0x0001420L, 0x0080020L, 0x0080420L, 0x0081020L, 0x0081420L,
+	0x0004000L, 0x0004400L, 0x0005000L, 0x0005400L, 0x0084000L, 0x0084400L, 0x0085000L, 0x0085400L,
+	0x0004020L, 0x0004420L, 0x0005020L, 0x0005420L, 0x0084020L, 0x0084420L, 0x0085020L, 0x0085420L,
+	0x0000800L, 0x0000c00L, 0x0001800L, 0x0001c00L, 0x0080800L, 0x0080c00L, 0x0081800L, 0x0081c00L,
+	0x0000820L, 0x0000c20L, 0x0001820L, 0x0001c20L, 0x0080820L, 0x0080c20L, 0x0081820L, 0x0081c20L,
+	0x0004800L, 0x0004c00L, 0x0005800L, 0x0005c00L, 0x0084800L, 0x0084c00L, 0x0085800L, 0x0085c00L,
+	0x0004820L, 0x0004c20L, 0x0005820L, 0x0005c20L, 0x0084820L, 0x0084c20L, 0x0085820L, 0x0085c20L }, {
+	0x0000000L, 0x0000100L, 0x0040000L, 0x0040100L, 0x0000000L, 0x0000100L, 0x0040000L, 0x0040100L,
+	0x0000040L, 0x0000140L, 0x0040040L, 0x0040140L, 0x0000040L, 0x0000140L, 0x0040040L, 0x0040140L,
+	0x0400000L, 0x0400100L, 0x0440000L, 0x0440100L, 0x0400000L, 0x0400100L, 0x0440000L, 0x0440100L,
+	0x0400040L, 0x0400140L, 0x0440040L, 0x0440140L, 0x0400040L, 0x0400140L, 0x0440040L, 0x0440140L,
+	0x0008000L, 0x0008100L, 0x0048000L, 0x0048100L, 0x0008000L, 0x0008100L, 0x0048000L, 0x0048100L,
+	0x0008040L, 0x0008140L, 0x0048040L, 0x0048140L, 0x0008040L, 0x0008140L, 0x0048040L, 0x0048140L,
+	0x0408000L, 0x0408100L, 0x0448000L, 0x0448100L, 0x0408000L, 0x0408100L, 0x0448000L, 0x0448100L,
+	0x0408040L, 0x0408140L, 0x0448040L, 0x0448140L, 0x0408040L, 0x0408140L, 0x0448040L, 0x0448140L,
+	0x0000008L, 0x0000108L, 0x0040008L, 0x0040108L, 0x0000008L, 0x0000108L, 0x0040008L, 0x0040108L,
+	0x0000048L, 0x0000148L, 0x0040048L, 0x0040148L, 0x0000048L, 0x0000148L, 0x0040048L, 0x0040148L,
+	0x0400008L, 0x0400108L, 0x0440008L, 0x0440108L, 0x0400008L, 0x0400108L, 0x0440008L, 0x0440108L,
+	0x0400048L, 0x0400148L, 0x0440048L, 0x0440148L, 0x0400048L, 0x0400148L, 0x0440048L, 0x0440148L,
+	0x0008008L, 0x0008108L, 0x0048008L, 0x0048108L, 0x0008008L, 0x0008108L, 0x0048008L, 0x0048108L,
+	0x0008048L, 0x0008148L, 0x0048048L, 0x0048148L, 0x0008048L, 0x0008148L, 0x0048048L, 0x0048148L,
+	0x0408008L, 0x0408108L, 0x0448008L, 0x0448108L, 0x0408008L, 0x0408108L, 0x0448008L, 0x0448108L,
+	0x0408048L, 0x0408148L, 0x0448048L, 0x0448148L, 0x0408048L, 0x0408148L, 0x0448048L, 0x0448148L } };
+
+
+static uint32_t SP1[64] DES_ALIGN = {
+	0x01010400L, 0x00000000L, 0x00010000L, 0x01010404L,
+	0x01010004L, 0x00010404L, 0x00000004L, 0x00010000L,
+	0x00000400L, 0x01010400L, 0x01010404L, 0x00000400L,
+	0x01000404L, 0x01010004L, 0x01000000L, 0x00000004L,
+	0x00000404L, 0x01000400L, 0x01000400L, 0x00010400L,
+	0x00010400L, 0x01010000L, 0x01010000L, 0x01000404L,
+	0x00010004L, 0x01000004L, 0x01000004L, 0x00010004L,
+	0x00000000L, 0x00000404L, 0x00010404L, 0x01000000L,
+	0x00010000L, 0x01010404L, 0x00000004L, 0x01010000L,
+	0x01010400L, 0x01000000L, 0x01000000L, 0x00000400L,
+	0x01010004L, 0x00010000L, 0x00010400L, 0x01000004L,
+	0x00000400L, 0x00000004L, 0x01000404L, 0x00010404L,
+	0x01010404L, 0x00010004L, 0x01010000L, 0x01000404L,
+	0x01000004L, 0x00000404L, 0x00010404L, 0x01010400L,
+	0x00000404L, 0x01000400L, 0x01000400L, 0x00000000L,
+	0x00010004L, 0x00010400L, 0x00000000L, 0x01010004L };
+
+static uint32_t SP2[64] DES_ALIGN = {
+	0x80108020L, 0x80008000L, 0x00008000L, 0x00108020L,
+	0x00100000L, 0x00000020L, 0x80100020L, 0x80008020L,
+	0x80000020L, 0x80108020L, 0x80108000L, 0x80000000L,
+	0x80008000L, 0x00100000L, 0x00000020L, 0x80100020L,
+	0x00108000L, 0x00100020L, 0x80008020L, 0x00000000L,
+	0x80000000L, 0x00008000L, 0x00108020L, 0x80100000L,
+	0x00100020L, 0x80000020L, 0x00000000L, 0x00108000L,
+	0x00008020L, 0x80108000L, 0x80100000L, 0x00008020L,
+	0x00000000L, 0x00108020L, 0x80100020L, 0x00100000L,
+	0x80008020L, 0x80100000L, 0x80108000L, 0x00008000L,
+	0x80100000L, 0x80008000L, 0x00000020L, 0x80108020L,
+	0x00108020L, 0x00000020L, 0x00008000L, 0x80000000L,
+	0x00008020L, 0x80108000L, 0x00100000L, 0x80000020L,
+	0x00100020L, 0x80008020L, 0x80000020L, 0x00100020L,
+	0x00108000L, 0x00000000L, 0x80008000L, 0x00008020L,
+	0x80000000L, 0x80100020L, 0x80108020L, 0x00108000L };
+
+static uint32_t SP3[64] DES_ALIGN = {
+	0x00000208L, 0x08020200L, 0x00000000L, 0x08020008L,
+	0x08000200L, 0x00000000L, 0x00020208L, 0x08000200L,
+	0x00020008L, 0x08000008L, 0x08000008L, 0x00020000L,
+	0x08020208L, 0x00020008L, 0x08020000L, 0x00000208L,
+	0x08000000L, 0x00000008L, 0x08020200L, 0x00000200L,
+	0x00020200L, 0x08020000L, 0x08020008L, 0x00020208L,
+	0x08000208L, 0x00020200L, 0x00020000L, 0x08000208L,
+	0x00000008L, 0x08020208L, 0x00000200L, 0x08000000L,
+	0x08020200L, 0x08000000L, 0x00020008L, 0x00000208L,
+	0x00020000L, 0x08020200L, 0x08000200L, 0x00000000L,
+	0x00000200L, 0x00020008L, 0x08020208L, 0x08000200L,
+	0x08000008L, 0x00000200L, 0x00000000L, 0x08020008L,
+	0x08000208L, 0x00020000L, 0x08000000L, 0x08020208L,
+	0x00000008L, 0x00020208L, 0x00020200L, 0x08000008L,
+	0x08020000L, 0x08000208L, 0x00000208L, 0x08020000L,
+	0x00020208L, 0x00000008L, 0x08020008L, 0x00020200L };
+
+static uint32_t SP4[64] DES_ALIGN = {
+	0x00802001L, 0x00002081L, 0x00002081L, 0x00000080L,
+	0x00802080L, 0x00800081L, 0x00800001L, 0x00002001L,
+	0x00000000L, 0x00802000L, 0x00802000L, 0x00802081L,
+	0x00000081L, 0x00000000L, 0x00800080L, 0x00800001L,
+	0x00000001L, 0x00002000L, 0x00800000L, 0x00802001L,
+	0x00000080L, 0x00800000L, 0x00002001L, 0x00002080L,
+	0x00800081L, 0x00000001L, 0x00002080L, 0x00800080L,
+	0x00002000L, 0x00802080L, 0x00802081L, 0x00000081L,
+	0x00800080L, 0x00800001L, 0x00802000L, 0x00802081L,
+	0x00000081L, 0x00000000L, 0x00000000L, 0x00802000L,
+	0x00002080L, 0x00800080L, 0x00800081L, 0x00000001L,
+	0x00802001L, 0x00002081L, 0x00002081L, 0x00000080L,
+	0x00802081L, 0x00000081L, 0x00000001L, 0x00002000L,
+	0x00800001L, 0x00002001L, 0x00802080L, 0x00800081L,
+	0x00002001L, 0x00002080L, 0x00800000L, 0x00802001L,
+	0x00000080L, 0x00800000L, 0x00002000L, 0x00802080L };
+
+static uint32_t SP5[64] DES_ALIGN = {
+	0x00000100L, 0x02080100L, 0x02080000L, 0x42000100L,
+	0x00080000L, 0x00000100L, 0x40000000L, 0x02080000L,
+	0x40080100L, 0x00080000L, 0x02000100L, 0x40080100L,
+	0x42000100L, 0x42080000L, 0x00080100L, 0x40000000L,
+	0x02000000L, 0x40080000L, 0x40080000L, 0x00000000L,
+	0x40000100L, 0x42080100L, 0x42080100L, 0x02000100L,
+	0x42080000L, 0x40000100L, 0x00000000L, 0x42000000L,
+	0x02080100L, 0x02000000L, 0x42000000L, 0x00080100L,
+	0x00080000L, 0x42000100L, 0x00000100L, 0x02000000L,
+	0x40000000L, 0x02080000L, 0x42000100L, 0x40080100L,
+	0x02000100L, 0x40000000L, 0x42080000L, 0x02080100L,
+	0x40080100L, 0x00000100L, 0x02000000L, 0x42080000L,
+	0x42080100L, 0x00080100L, 0x42000000L, 0x42080100L,
+	0x02080000L, 0x00000000L, 0x40080000L, 0x42000000L,
+	0x00080100L, 0x02000100L, 0x40000100L, 0x00080000L,
+	0x00000000L, 0x40080000L, 0x02080100L, 0x40000100L };
+
+static uint32_t SP6[64] DES_ALIGN = {
+	0x20000010L, 0x20400000L, 0x00004000L, 0x20404010L,
+	0x20400000L, 0x00000010L, 0x20404010L, 0x00400000L,
+	0x20004000L, 0x00404010L, 0x00400000L, 0x20000010L,
+	0x00400010L, 0x20004000L, 0x20000000L, 0x00004010L,
+	0x00000000L, 0x00400010L, 0x20004010L, 0x00004000L,
+	0x00404000L, 0x20004010L, 0x00000010L, 0x20400010L,
+	0x20400010L, 0x00000000L, 0x00404010L, 0x20404000L,
+	0x00004010L, 0x00404000L, 0x20404000L, 0x20000000L,
+	0x20004000L, 0x00000010L, 0x20400010L, 0x00404000L,
+	0x20404010L, 0x00400000L, 0x00004010L, 0x20000010L,
+	0x00400000L, 0x20004000L, 0x20000000L, 0x00004010L,
+	0x20000010L, 0x20404010L, 0x00404000L, 0x20400000L,
+	0x00404010L, 0x20404000L, 0x00000000L, 0x20400010L,
+	0x00000010L, 0x00004000L, 0x20400000L, 0x00404010L,
+	0x00004000L, 0x00400010L, 0x20004010L, 0x00000000L,
+	0x20404000L, 0x20000000L, 0x00400010L, 0x20004010L };
+
+static uint32_t SP7[64] DES_ALIGN = {
+	0x00200000L, 0x04200002L, 0x04000802L, 0x00000000L,
+	0x00000800L, 0x04000802L, 0x00200802L, 0x04200800L,
+	0x04200802L, 0x00200000L, 0x00000000L, 0x04000002L,
+	0x00000002L, 0x04000000L, 0x04200002L, 0x00000802L,
+	0x04000800L, 0x00200802L, 0x00200002L, 0x04000800L,
+	0x04000002L, 0x04200000L, 0x04200800L, 0x00200002L,
+	0x04200000L, 0x00000800L, 0x00000802L, 0x04200802L,
+	0x00200800L, 0x00000002L, 0x04000000L, 0x00200800L,
+	0x04000000L, 0x00200800L, 0x00200000L, 0x04000802L,
+	0x04000802L, 0x04200002L, 0x04200002L, 0x00000002L,
+	0x00200002L, 0x04000000L, 0x04000800L, 0x00200000L,
+	0x04200800L, 0x00000802L, 0x00200802L, 0x04200800L,
+	0x00000802L, 0x04000002L, 0x04200802L, 0x04200000L,
+	0x00200800L, 0x00000000L, 0x00000002L, 0x04200802L,
+	0x00000000L, 0x00200802L, 0x04200000L, 0x00000800L,
+	0x04000002L, 0x04000800L, 0x00000800L, 0x00200002L };
+
+static uint32_t SP8[64] DES_ALIGN = {
+	0x10001040L, 0x00001000L, 0x00040000L, 0x10041040L,
+	0x10000000L, 0x10001040L, 0x00000040L, 0x10000000L,
+	0x00040040L, 0x10040000L, 0x10041040L, 0x00041000L,
+	0x10041000L, 0x00041040L, 0x00001000L, 0x00000040L,
+	0x10040000L, 0x10000040L, 0x10001000L, 0x00001040L,
+	0x00041000L, 0x00040040L, 0x10040040L, 0x10041000L,
+	0x00001040L, 0x00000000L, 0x00000000L, 0x10040040L,
+	0x10000040L, 0x10001000L, 0x00041040L, 0x00040000L,
+	0x00041040L, 0x00040000L, 0x10041000L, 0x00001000L,
+	0x00000040L, 0x10040040L, 0x00001000L, 0x00041040L,
+	0x10001000L, 0x00000040L, 0x10000040L, 0x10040000L,
+	0x10040040L, 0x10000000L, 0x00040000L, 0x10001040L,
+	0x00000000L, 0x10041040L, 0x00040040L, 0x10000040L,
+	0x10040000L, 0x10001000L, 0x10001040L, 0x00000000L,
+	0x10041040L, 0x00041000L, 0x00041000L, 0x00001040L,
+	0x00001040L, 0x00040040L, 0x10000000L, 0x10041000L };
+
+/* Internal functions */
+static void rawkey(unsigned char *, uint32_t *);
+static void cookey(register uint32_t *, register uint32_t *);
+static void revkey(register uint32_t *, register uint32_t *);
+static void scrunch(register unsigned char *, register uint32_t *);
+static void unscrun(register uint32_t *, register unsigned char *);
+static void desfunc(register uint32_t *, register uint32_t *);
+static void desfunc3(register uint32_t *, uint32_t *, uint32_t *, uint32_t *);
+static void desfunc4(uint32_t *, uint32_t *, uint32_t *, uint32_t *);
+static void desfunc4m(uint32_t *, uint32_t *[4][3]);
+
+/* Key schedule used by the original deskey()/usekey()/cpkey()/des()
+ * calls. It is per thread, so those calls no longer trample each other,
+ * but a key loaded in one thread is not visible in another. Everything
+ * else in this module keeps its schedules in the caller's des_ctx or
+ * des3_ctx (or the buffer given to deskey_r()) and is reentrant.
+ */
+static __thread uint32_t KnL[32] DES_ALIGN = { 0L };
+
+/* Bulk calls of at least this many blocks go through the bitsliced
+ * engine (desbs.c), whole groups of lanes at a time; the rest use the
+ * table driven desfunc(). 0 disables the bitsliced engine. Like the
+ * kernel choice below this is process wide configuration: set it
+ * before starting threads.
+ */
+static int bs_threshold = DES_BS_THRESHOLD;
+
+static int cpu_any(void)
+{
+	return 1;
+}
+
+#ifdef DES_X86_KERNELS
+static int cpu_sse2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+}
+
+static int cpu_avx2(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static int cpu_avx512(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx512f");
+}
+#endif
+
+/* Available kernels, best first. The first one this CPU supports is
+ * bound on first use, unless TESTDES_KERNEL or des_set_kernel() picks
+ * another.
+ */
+static des_kernel kernels[] = {
+#ifdef DES_X86_KERNELS
+	{ "avx512", 512, des_bs_ecb_avx512, des_bs_ecb3_avx512, cpu_avx512 },
+	{ "avx2",   256, des_bs_ecb_avx2,   des_bs_ecb3_avx2,   cpu_avx2 },
+	{ "sse2",   128, des_bs_ecb_sse2,   des_bs_ecb3_sse2,   cpu_sse2 },
+#endif
+	{ "scalar",  64, des_bs_ecb_scalar, des_bs_ecb3_scalar, cpu_any },
+	{ "table",    0, NULL,              NULL,               cpu_any },
+	{ NULL,       0, NULL,              NULL,               NULL }
+};
+
+static des_kernel *kernel = NULL;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static des_kernel *find_kernel(const char *name)
+{
+	des_kernel *k;
+
+	for( k = kernels; k->name != NULL; k++ )
+	{
+		if( name == NULL || *name == 0 || strcmp(name,"auto") == 0 )
+		{
+			if( k->supported() )
+				return(k);
+		}
+		else if( strcmp(name,k->name) == 0 )
+			return(k->supported() ? k : NULL);
+	}
+	return(NULL);
+}
+
+/* Runs once per process, from whichever thread gets here first */
+static void kernel_init(void)
+{
+	char *name;
+
+	name = getenv("TESTDES_KERNEL");
+	kernel = find_kernel(name);
+	if( kernel == NULL )
+	{
+		fprintf(stderr,"TESTDES_KERNEL: unknown or unsupported kernel '%s'\n",name);
+		kernel = find_kernel(NULL);
+	}
+}
+
+static des_kernel *cur_kernel(void)
+{
+	pthread_once(&kernel_once,kernel_init);
+	return kernel;
+}
+
+/* Run as many of blocks as the bitsliced kernels take, widest first
+ * then 64-block groups on the scalar kernel. Returns blocks done.
+ */
+static int bulk_ecb(uint32_t *keys, unsigned char *data, int blocks)
+{
+	des_kernel *k;
+	int n, done;
+
+	k = cur_kernel();
+	if( bs_threshold <= 0 || blocks < bs_threshold || k->lanes == 0 )
+		return 0;
+	done = blocks - blocks % k->lanes;
+	if( done > 0 )
+		k->ecb(keys,data,done);
+	n = (blocks - done) - (blocks - done) % DES_BS_LANES;
+	if( n > 0 )
+		des_bs_ecb_scalar(keys,data + done * 8,n);
+	return done + n;
+}
+
+static int bulk_ecb3(uint32_t *k1, uint32_t *k2, uint32_t *k3,
+			unsigned char *data, int blocks)
+{
+	des_kernel *k;
+	int n, done;
+
+	k = cur_kernel();
+	if( bs_threshold <= 0 || blocks < bs_threshold || k->lanes == 0 )
+		return 0;
+	done = blocks - blocks % k->lanes;
+	if( done > 0 )
+		k->ecb3(k1,k2,k3,data,done);
+	n = (blocks - done) - (blocks - done) % DES_BS_LANES;
+	if( n > 0 )
+		des_bs_ecb3_scalar(k1,k2,k3,data + done * 8,n);
+	return done + n;
+}
 
 /* Validation sets:
  *
@@ -25,53 +557,66 @@
 
 void deskey(unsigned char *key, short edf)	/* Thanks to James Gillogly & Phil Karn! */
 {
-	register int i, j, l, m, n, o;
-	unsigned char pc1m[56], pcr[56];
-	unsigned long kn[32];
+	deskey_r(key, edf, KnL);
+	return;
+}
+
+/* Reentrant deskey(): the cooked schedule for key and edf (EN0 or
+ * DE1) is written to the caller's kn[32] instead of the KnL global.
+ */
+void deskey_r(unsigned char *key, short edf, uint32_t *kn)
+{
+	uint32_t raw[32] DES_ALIGN, dough[32] DES_ALIGN;
+	DES_PROF_START(t);
 
-	for ( j = 0; j < 56; j++ )
+	DES_PROBE1(key_start, 1);
+	rawkey(key, raw);
+	if( edf == DE1 )
 	{
-		l = pc1[j];
-		m = l & 07;
-		pc1m[j] = (key[l >> 3] & bytebit[m]) ? 1 : 0;
+		cookey(raw, dough);
+		revkey(dough, kn);
 	}
+	else cookey(raw, kn);
+	DES_PROBE1(key_end, 1);
+	DES_PROF_END(DES_PROF_KEY, t);
+	return;
+}
 
-	for( i = 0; i < 16; i++ )
+/* Expand key into the 32 raw (uncooked) encrypt subkey words, two
+ * 24-bit halves per round. Word-oriented version of the original
+ * per-bit pc1m[]/pcr[] loops: C and D are kept as 28-bit registers,
+ * rotated in place, and PC2 is applied 7 bits at a time by table.
+ */
+static void rawkey(unsigned char *key, uint32_t *kn)
+{
+	register uint32_t c, d, cr, dr;
+	register int i, r;
+
+	c = d = 0L;
+	for( i = 0; i < 8; i++ )
 	{
-		if( edf == DE1 ) m = (15 - i) << 1;
-		else m = i << 1;
-		n = m + 1;
-		kn[m] = kn[n] = 0L;
-		for( j = 0; j < 28; j++ )
-		{
-			l = j + totrot[i];
-			if( l < 28 ) pcr[j] = pc1m[l];
-			else pcr[j] = pc1m[l - 28];
-		}
-		for( j = 28; j < 56; j++ )
-		{
-		    l = j + totrot[i];
-		    if( l < 56 ) pcr[j] = pc1m[l];
-		    else pcr[j] = pc1m[l - 28];
-	    	}
-		for( j = 0; j < 24; j++ )
-		{
-			if( pcr[pc2[j]] ) kn[m] |= bigbyte[j];
-			if( pcr[pc2[j+24]] ) kn[n] |= bigbyte[j];
-		}
+		c |= pc1c[i << 1][key[i] >> 4] | pc1c[(i << 1) + 1][key[i] & 0x0f];
+		d |= pc1d[i << 1][key[i] >> 4] | pc1d[(i << 1) + 1][key[i] & 0x0f];
 	}
 
-	cookey(kn);
+	for( i = 0; i < 16; i++ )
+	{
+		r = totrot[i];
+		cr = ((c << r) | (c >> (28 - r))) & 0x0fffffffL;
+		dr = ((d << r) | (d >> (28 - r))) & 0x0fffffffL;
+		*kn++ = pc2c[0][cr >> 21] | pc2c[1][(cr >> 14) & 0x7f]
+		      | pc2c[2][(cr >> 7) & 0x7f] | pc2c[3][cr & 0x7f];
+		*kn++ = pc2d[0][dr >> 21] | pc2d[1][(dr >> 14) & 0x7f]
+		      | pc2d[2][(dr >> 7) & 0x7f] | pc2d[3][dr & 0x7f];
+	}
 	return;
 }
 
-static void cookey(register unsigned long *raw1)
+static void cookey(register uint32_t *raw1, register uint32_t *cook)
 {
-	register unsigned long *cook, *raw0;
-	unsigned long dough[32];
-	register int i,j,k,o;
+	register uint32_t *raw0;
+	register int i;
 
-	cook = dough;
 	for( i = 0; i < 16; i++, raw1++ )
 	{
 		raw0 = raw1++;
@@ -84,35 +629,36 @@ static void cookey(register unsigned long *raw1)
 		*cook	|= (*raw1 & 0x0003f000L) >> 4;
 		*cook++	|= (*raw1 & 0x0000003fL);
 	}
-/*	o = 0;
-	for(i=0;i<32;i++) {
-		j = dough[i]/0x10000;
-		k = dough[i] & 0xFFFF;
-		printf("i: %d, 0x%2.2x%4.4x\n",i,j,k);
-		if (o == 7) {
-			o = pause();
-			o = 0;
-		}
+	return;
+}
+
+/* The decrypt schedule is the encrypt schedule with the per-round
+ * subkey pairs in reverse order.
+ */
+static void revkey(register uint32_t *ek, register uint32_t *dk)
+{
+	register int i;
 
-		o++;
+	for( i = 0; i < 32; i += 2 )
+	{
+		dk[i]	  = ek[30 - i];
+		dk[i + 1] = ek[31 - i];
 	}
-*/
-	usekey(dough);
 	return;
 }
 
-void cpkey(register unsigned long *into)
+void cpkey(register uint32_t *into)
 {
-	register unsigned long *from, *endp;
+	register uint32_t *from, *endp;
 
 	from = KnL, endp = &KnL[32];
 	while( from < endp ) *into++ = *from++;
 	return;
 }
 
-void usekey(register unsigned long *from)
+void usekey(register uint32_t *from)
 {
-	register unsigned long *to, *endp;
+	register uint32_t *to, *endp;
 
 	to = KnL, endp = &KnL[32];
 	while( to < endp ) *to++ = *from++;
@@ -121,15 +667,24 @@ void usekey(register unsigned long *from)
 
 void des(unsigned char *inblock, unsigned char *outblock)
 {
-	unsigned long work[2];
+	des_r(KnL, inblock, outblock);
+	return;
+}
+
+/* Reentrant des(): one block through the schedule kn */
+void des_r(uint32_t *kn, unsigned char *inblock, unsigned char *outblock)
+{
+	uint32_t work[2];
+	DES_PROF_START(t);
 
 	scrunch(inblock, work);
-	desfunc(work, KnL);
+	desfunc(work, kn);
 	unscrun(work, outblock);
+	DES_PROF_END(DES_PROF_CIPHER, t);
 	return;
 }
 
-static void scrunch(register unsigned char *outof, register unsigned long *into)
+static void scrunch(register unsigned char *outof, register uint32_t *into)
 {
 	*into 	 = (*outof++ & 0xffL) << 24;
 	*into 	|= (*outof++ & 0xffL) << 16;
@@ -142,7 +697,7 @@ static void scrunch(register unsigned char *outof, register unsigned long *into)
 	return;
 }
 
-static void unscrun(register unsigned long *outof, register unsigned char *into)
+static void unscrun(register uint32_t *outof, register unsigned char *into)
 {
 	*into++ = (*outof >> 24) & 0xffL;
 	*into++ = (*outof >> 16) & 0xffL;
@@ -155,88 +710,285 @@ static void unscrun(register unsigned long *outof, register unsigned char *into)
 	return;
 }
 
-static void desfunc(register unsigned long *block, register unsigned long *keys)
+/* The three pieces of desfunc() - initial permutation, 16 rounds
+ * and final permutation - are macros so that desfunc3() can run the
+ * rounds of all three Triple DES passes between one IP and one FP.
+ * FP followed by IP is the identity, apart from the left/right swap.
+ */
+#define DES_IP(leftt, right, work) \
+{ \
+	work = ((leftt >> 4) ^ right) & 0x0f0f0f0fL; \
+	right ^= work; \
+	leftt ^= (work << 4); \
+	work = ((leftt >> 16) ^ right) & 0x0000ffffL; \
+	right ^= work; \
+	leftt ^= (work << 16); \
+	work = ((right >> 2) ^ leftt) & 0x33333333L; \
+	leftt ^= work; \
+	right ^= (work << 2); \
+	work = ((right >> 8) ^ leftt) & 0x00ff00ffL; \
+	leftt ^= work; \
+	right ^= (work << 8); \
+	right = ((right << 1) | ((right >> 31) & 1L)) & 0xffffffffL; \
+	work = (leftt ^ right) & 0xaaaaaaaaL; \
+	leftt ^= work; \
+	right ^= work; \
+	leftt = ((leftt << 1) | ((leftt >> 31) & 1L)) & 0xffffffffL; \
+}
+
+/* One half round: leftt ^= f(right, next subkey pair) */
+#define DES_HALF(leftt, right, work, fval, keys) \
+{ \
+	work  = (right << 28) | (right >> 4); \
+	work ^= *keys++; \
+	fval  = SP7[ work	 & 0x3fL]; \
+	fval |= SP5[(work >>  8) & 0x3fL]; \
+	fval |= SP3[(work >> 16) & 0x3fL]; \
+	fval |= SP1[(work >> 24) & 0x3fL]; \
+	work  = right ^ *keys++; \
+	fval |= SP8[ work	 & 0x3fL]; \
+	fval |= SP6[(work >>  8) & 0x3fL]; \
+	fval |= SP4[(work >> 16) & 0x3fL]; \
+	fval |= SP2[(work >> 24) & 0x3fL]; \
+	leftt ^= fval; \
+}
+
+#define DES_ROUNDS(leftt, right, work, fval, keys) \
+{ \
+	register int round; \
+	for( round = 0; round < 8; round++ ) \
+	{ \
+		DES_HALF(leftt, right, work, fval, keys); \
+		DES_HALF(right, leftt, work, fval, keys); \
+	} \
+}
+
+#define DES_FP(leftt, right, work) \
+{ \
+	right = (right << 31) | (right >> 1); \
+	work = (leftt ^ right) & 0xaaaaaaaaL; \
+	leftt ^= work; \
+	right ^= work; \
+	leftt = (leftt << 31) | (leftt >> 1); \
+	work = ((leftt >> 8) ^ right) & 0x00ff00ffL; \
+	right ^= work; \
+	leftt ^= (work << 8); \
+	work = ((leftt >> 2) ^ right) & 0x33333333L; \
+	right ^= work; \
+	leftt ^= (work << 2); \
+	work = ((right >> 16) ^ leftt) & 0x0000ffffL; \
+	leftt ^= work; \
+	right ^= (work << 16); \
+	work = ((right >> 4) ^ leftt) & 0x0f0f0f0fL; \
+	leftt ^= work; \
+	right ^= (work << 4); \
+}
+
+static void desfunc(register uint32_t *block, register uint32_t *keys)
 {
-	register unsigned long fval, work, right, leftt;
-	register int round;
+	register uint32_t fval, work, right, leftt;
 
 	leftt = block[0];
 	right = block[1];
-	work = ((leftt >> 4) ^ right) & 0x0f0f0f0fL;
-	right ^= work;
-	leftt ^= (work << 4);
-	work = ((leftt >> 16) ^ right) & 0x0000ffffL;
-	right ^= work;
-	leftt ^= (work << 16);
-	work = ((right >> 2) ^ leftt) & 0x33333333L;
-	leftt ^= work;
-	right ^= (work << 2);
-	work = ((right >> 8) ^ leftt) & 0x00ff00ffL;
-	leftt ^= work;
-	right ^= (work << 8);
-	right = ((right << 1) | ((right >> 31) & 1L)) & 0xffffffffL;
-	work = (leftt ^ right) & 0xaaaaaaaaL;
-	leftt ^= work;
-	right ^= work;
-	leftt = ((leftt << 1) | ((leftt >> 31) & 1L)) & 0xffffffffL;
-
-	for( round = 0; round < 8; round++ )
-	{
-		work  = (right << 28) | (right >> 4);
-		work ^= *keys++;
-		fval  = SP7[ work		 & 0x3fL];
-		fval |= SP5[(work >>  8) & 0x3fL];
-		fval |= SP3[(work >> 16) & 0x3fL];
-		fval |= SP1[(work >> 24) & 0x3fL];
-		work  = right ^ *keys++;
-		fval |= SP8[ work		 & 0x3fL];
-		fval |= SP6[(work >>  8) & 0x3fL];
-		fval |= SP4[(work >> 16) & 0x3fL];
-		fval |= SP2[(work >> 24) & 0x3fL];
-		leftt ^= fval;
-		work  = (leftt << 28) | (leftt >> 4);
-		work ^= *keys++;
-		fval  = SP7[ work		 & 0x3fL];
-		fval |= SP5[(work >>  8) & 0x3fL];
-		fval |= SP3[(work >> 16) & 0x3fL];
-		fval |= SP1[(work >> 24) & 0x3fL];
-		work  = leftt ^ *keys++;
-		fval |= SP8[ work		 & 0x3fL];
-		fval |= SP6[(work >>  8) & 0x3fL];
-		fval |= SP4[(work >> 16) & 0x3fL];
-		fval |= SP2[(work >> 24) & 0x3fL];
-		right ^= fval;
-	}
+	DES_IP(leftt, right, work);
+	DES_ROUNDS(leftt, right, work, fval, keys);
+	DES_FP(leftt, right, work);
+	*block++ = right;
+	*block = leftt;
+	return;
+}
+
+/* Three DES passes (one Triple DES block) with a single IP and FP.
+ * Equivalent to desfunc(block,k1); desfunc(block,k2); desfunc(block,k3);
+ */
+static void desfunc3(register uint32_t *block, uint32_t *k1,
+			uint32_t *k2, uint32_t *k3)
+{
+	register uint32_t fval, work, right, leftt;
 
-	right = (right << 31) | (right >> 1);
-	work = (leftt ^ right) & 0xaaaaaaaaL;
-	leftt ^= work;
-	right ^= work;
-	leftt = (leftt << 31) | (leftt >> 1);
-	work = ((leftt >> 8) ^ right) & 0x00ff00ffL;
-	right ^= work;
-	leftt ^= (work << 8);
-	work = ((leftt >> 2) ^ right) & 0x33333333L;
-	right ^= work;
-	leftt ^= (work << 2);
-	work = ((right >> 16) ^ leftt) & 0x0000ffffL;
-	leftt ^= work;
-	right ^= (work << 16);
-	work = ((right >> 4) ^ leftt) & 0x0f0f0f0fL;
-	leftt ^= work;
-	right ^= (work << 4);
+	leftt = block[0];
+	right = block[1];
+	DES_IP(leftt, right, work);
+	DES_ROUNDS(leftt, right, work, fval, k1);
+	work = leftt; leftt = right; right = work;
+	DES_ROUNDS(leftt, right, work, fval, k2);
+	work = leftt; leftt = right; right = work;
+	DES_ROUNDS(leftt, right, work, fval, k3);
+	DES_FP(leftt, right, work);
 	*block++ = right;
 	*block = leftt;
 	return;
 }
 
 
+/* Four independent blocks (block[0..7], two words each) through the
+ * same schedule. The lanes share no data, so interleaving their rounds
+ * lets the core overlap one lane's S-box loads with the others', where
+ * desfunc() waits on a single dependency chain. With k2 and k3 given
+ * it does the three passes of desfunc3() instead of one.
+ */
+#define DES_HALF4(a, b, keys) \
+{ \
+	DES_HALF(a##0, b##0, work, fval, keys); keys -= 2; \
+	DES_HALF(a##1, b##1, work, fval, keys); keys -= 2; \
+	DES_HALF(a##2, b##2, work, fval, keys); keys -= 2; \
+	DES_HALF(a##3, b##3, work, fval, keys); \
+}
+
+static void desfunc4(uint32_t *block, uint32_t *k1, uint32_t *k2,
+			uint32_t *k3)
+{
+	register uint32_t fval, work;
+	register uint32_t l0, r0, l1, r1, l2, r2, l3, r3;
+	uint32_t *keys[3], *kp;
+	register int pass, round;
+
+	keys[0] = k1;
+	keys[1] = k2;
+	keys[2] = k3;
+	l0 = block[0]; r0 = block[1];
+	l1 = block[2]; r1 = block[3];
+	l2 = block[4]; r2 = block[5];
+	l3 = block[6]; r3 = block[7];
+	DES_IP(l0, r0, work);
+	DES_IP(l1, r1, work);
+	DES_IP(l2, r2, work);
+	DES_IP(l3, r3, work);
+	for( pass = 0; pass < 3 && keys[pass] != NULL; pass++ )
+	{
+		if( pass > 0 )
+		{
+			work = l0; l0 = r0; r0 = work;
+			work = l1; l1 = r1; r1 = work;
+			work = l2; l2 = r2; r2 = work;
+			work = l3; l3 = r3; r3 = work;
+		}
+		kp = keys[pass];
+		for( round = 0; round < 8; round++ )
+		{
+			DES_HALF4(l, r, kp);
+			DES_HALF4(r, l, kp);
+		}
+	}
+	DES_FP(l0, r0, work);
+	DES_FP(l1, r1, work);
+	DES_FP(l2, r2, work);
+	DES_FP(l3, r3, work);
+	block[0] = r0; block[1] = l0;
+	block[2] = r1; block[3] = l1;
+	block[4] = r2; block[5] = l2;
+	block[6] = r3; block[7] = l3;
+}
+
+/* desfunc4() with a schedule per lane: keys[i] holds the one (or three)
+ * schedules for block i. Each lane walks its own schedule, so the four
+ * blocks need not share a key, and the rounds interleave just the same.
+ * keys[i][1] NULL (for every lane) means one pass.
+ */
+#define DES_HALF4M(a, b, kp) \
+{ \
+	DES_HALF(a##0, b##0, work, fval, kp[0]); \
+	DES_HALF(a##1, b##1, work, fval, kp[1]); \
+	DES_HALF(a##2, b##2, work, fval, kp[2]); \
+	DES_HALF(a##3, b##3, work, fval, kp[3]); \
+}
+
+static void desfunc4m(uint32_t *block, uint32_t *keys[4][3])
+{
+	register uint32_t fval, work;
+	register uint32_t l0, r0, l1, r1, l2, r2, l3, r3;
+	uint32_t *kp[4];
+	register int pass, round;
+
+	l0 = block[0]; r0 = block[1];
+	l1 = block[2]; r1 = block[3];
+	l2 = block[4]; r2 = block[5];
+	l3 = block[6]; r3 = block[7];
+	DES_IP(l0, r0, work);
+	DES_IP(l1, r1, work);
+	DES_IP(l2, r2, work);
+	DES_IP(l3, r3, work);
+	for( pass = 0; pass < 3 && keys[0][pass] != NULL; pass++ )
+	{
+		if( pass > 0 )
+		{
+			work = l0; l0 = r0; r0 = work;
+			work = l1; l1 = r1; r1 = work;
+			work = l2; l2 = r2; r2 = work;
+			work = l3; l3 = r3; r3 = work;
+		}
+		kp[0] = keys[0][pass];
+		kp[1] = keys[1][pass];
+		kp[2] = keys[2][pass];
+		kp[3] = keys[3][pass];
+		for( round = 0; round < 8; round++ )
+		{
+			DES_HALF4M(l, r, kp);
+			DES_HALF4M(r, l, kp);
+		}
+	}
+	DES_FP(l0, r0, work);
+	DES_FP(l1, r1, work);
+	DES_FP(l2, r2, work);
+	DES_FP(l3, r3, work);
+	block[0] = r0; block[1] = l0;
+	block[2] = r1; block[3] = l1;
+	block[4] = r2; block[5] = l2;
+	block[6] = r3; block[7] = l3;
+}
+
+
 void des_key(des_ctx *dc, unsigned char *key)
 {
-	deskey(key,EN0);
-	cpkey(dc->ek);
-	deskey(key,DE1);
-	cpkey(dc->dk);
+	uint32_t kn[32];
+	DES_PROF_START(t);
+
+	DES_PROBE1(key_start, 1);
+	rawkey(key,kn);
+	cookey(kn,dc->ek);
+	revkey(dc->ek,dc->dk);
+	DES_PROBE1(key_end, 1);
+	DES_PROF_END(DES_PROF_KEY,t);
+}
+
+/* ECB over blocks in place with schedule k1, or the three Triple DES
+   passes k1,k2,k3 if k2 is not NULL. Whole groups of lanes go to the
+   bitsliced kernels, the rest to the table code four blocks at a time
+   and then singly. */
+
+static void ecb_run(uint32_t *k1, uint32_t *k2, uint32_t *k3,
+			unsigned char *data, int blocks)
+{
+	uint32_t work[8];
+	int i, bulk;
+	DES_PROF_START(t);
+
+	DES_PROBE2(ecb_start, blocks, k2 == NULL ? 1 : 3);
+	if( k2 == NULL )
+		bulk = bulk_ecb(k1,data,blocks);
+	else
+		bulk = bulk_ecb3(k1,k2,k3,data,blocks);
+	data += bulk * 8;
+	blocks -= bulk;
+	for( ; blocks >= 4; blocks -= 4, data += 32 )
+	{
+		for( i = 0; i < 4; i++ )
+			scrunch(data + i * 8,work + i * 2);
+		desfunc4(work,k1,k2,k3);
+		for( i = 0; i < 4; i++ )
+			unscrun(work + i * 2,data + i * 8);
+	}
+	for( ; blocks > 0; blocks--, data += 8 )
+	{
+		scrunch(data,work);
+		if( k2 == NULL )
+			desfunc(work,k1);
+		else
+			desfunc3(work,k1,k2,k3);
+		unscrun(work,data);
+	}
+	DES_PROBE2(ecb_end, bulk, k2 == NULL ? 1 : 3);
+	DES_PROF_END(DES_PROF_CIPHER,t);
 }
 
 /* Encrypt several blocks in ECB. Caller is responsible for
@@ -244,174 +996,476 @@ void des_key(des_ctx *dc, unsigned char *key)
 
 void des_enc(des_ctx *dc, unsigned char *data, int blocks)
 {
-	unsigned long work[2];
-	int i;
-	unsigned char *cp;
+	ecb_run(dc->ek,NULL,NULL,data,blocks);
+}
 
-	cp = data;
-	for(i=0;i<blocks;i++)
+void des_dec(des_ctx *dc, unsigned char *data, int blocks)
+{
+	ecb_run(dc->dk,NULL,NULL,data,blocks);
+}
+
+/* Set up a two-key Triple DES (EDE) context. The key is 16 bytes,
+   K1 followed by K2, and K3 = K1. All schedules are built once here
+   so that des3_enc/des3_dec never have to re-key. */
+
+void des3_key(des3_ctx *dc, unsigned char *key)
+{
+	uint32_t kn[32];
+	DES_PROF_START(t);
+
+	DES_PROBE1(key_start, 2);
+	rawkey(key,kn);
+	cookey(kn,dc->ek1);
+	revkey(dc->ek1,dc->dk1);
+	rawkey(key+8,kn);
+	cookey(kn,dc->ek2);
+	revkey(dc->ek2,dc->dk2);
+	memcpy(dc->ek3,dc->ek1,sizeof(dc->ek3));
+	memcpy(dc->dk3,dc->dk1,sizeof(dc->dk3));
+	DES_PROBE1(key_end, 2);
+	DES_PROF_END(DES_PROF_KEY,t);
+}
+
+/* Set up a three-key Triple DES (EDE) context from 24 bytes, K1, K2
+   then K3. Everything else treats it like a two-key context. */
+
+void des3_key3(des3_ctx *dc, unsigned char *key)
+{
+	uint32_t kn[32];
+	DES_PROF_START(t);
+
+	DES_PROBE1(key_start, 3);
+	rawkey(key,kn);
+	cookey(kn,dc->ek1);
+	revkey(dc->ek1,dc->dk1);
+	rawkey(key+8,kn);
+	cookey(kn,dc->ek2);
+	revkey(dc->ek2,dc->dk2);
+	rawkey(key+16,kn);
+	cookey(kn,dc->ek3);
+	revkey(dc->ek3,dc->dk3);
+	DES_PROBE1(key_end, 3);
+	DES_PROF_END(DES_PROF_KEY,t);
+}
+
+/* Triple DES encrypt (E(K3,D(K2,E(K1,x)))) several blocks in ECB.
+   Caller is responsible for short blocks */
+
+void des3_enc(des3_ctx *dc, unsigned char *data, int blocks)
+{
+	ecb_run(dc->ek1,dc->dk2,dc->ek3,data,blocks);
+}
+
+void des3_dec(des3_ctx *dc, unsigned char *data, int blocks)
+{
+	ecb_run(dc->dk3,dc->ek2,dc->dk1,data,blocks);
+}
+
+/* ECB over n independent buffers, each under its own key. ctxs[i],
+   data[i] and blocks[i] describe buffer i. One short message gives
+   des_enc() nothing to run in parallel, so the blocks of all the
+   short buffers are dealt out four at a time to desfunc4m(), whatever
+   their keys; buffers long enough for the bitsliced kernels still go
+   through ecb_run() whole. */
+
+#define MULTI_BULK(blocks)	(bs_threshold > 0 && (blocks) >= bs_threshold)
+
+/* The schedules of ctx, in the order ecb_run() takes them */
+static void multi_keys(void *ctx, int tdes, int dec, uint32_t **k)
+{
+	des_ctx *dc = ctx;
+	des3_ctx *d3 = ctx;
+
+	if( !tdes )
 	{
-		scrunch(cp,work);
-		desfunc(work,dc->ek);
-		unscrun(work,cp);
-		cp+=8;
+		k[0] = dec ? dc->dk : dc->ek;
+		k[1] = k[2] = NULL;
+	} else if( !dec ) {
+		k[0] = d3->ek1;
+		k[1] = d3->dk2;
+		k[2] = d3->ek3;
+	} else {
+		k[0] = d3->dk3;
+		k[1] = d3->ek2;
+		k[2] = d3->dk1;
 	}
 }
 
-void des_dec(des_ctx *dc, unsigned char *data, int blocks)
+/* The short buffers, four blocks at a time across buffers */
+static void ecb_lanes(void **ctxs, int tdes, int dec, unsigned char **data,
+			int *blocks, int n)
 {
-	unsigned long work[2];
-	int i;
-	unsigned char *cp;
+	uint32_t work[8], *keys[4][3], *k[3];
+	unsigned char *out[4];
+	int s, b, lanes, i;
+	DES_PROF_START(t);
 
-	cp = data;
-	for(i=0;i<blocks;i++)
+	lanes = 0;
+	for( s = 0; s < n; s++ )
+	{
+		if( blocks[s] <= 0 || MULTI_BULK(blocks[s]) )
+			continue;
+		multi_keys(ctxs[s],tdes,dec,k);
+		for( b = 0; b < blocks[s]; b++ )
+		{
+			out[lanes] = data[s] + b * 8;
+			keys[lanes][0] = k[0];
+			keys[lanes][1] = k[1];
+			keys[lanes][2] = k[2];
+			scrunch(out[lanes],work + lanes * 2);
+			if( ++lanes < 4 )
+				continue;
+			desfunc4m(work,keys);
+			for( i = 0; i < 4; i++ )
+				unscrun(work + i * 2,out[i]);
+			lanes = 0;
+		}
+	}
+	for( i = 0; i < lanes; i++ )
 	{
-		scrunch(cp,work);
-		desfunc(work,dc->dk);
-		unscrun(work,cp);
-		cp+=8;
+		if( tdes )
+			desfunc3(work + i * 2,keys[i][0],keys[i][1],keys[i][2]);
+		else
+			desfunc(work + i * 2,keys[i][0]);
+		unscrun(work + i * 2,out[i]);
 	}
+	DES_PROF_END(DES_PROF_CIPHER,t);
 }
 
-int pause(void)
+static void ecb_multi(void **ctxs, int tdes, int dec, unsigned char **data,
+			int *blocks, int n)
 {
-	int i;
+	uint32_t *k[3];
+	int s;
 
-	i = getchar();
+	for( s = 0; s < n; s++ )
+	{
+		if( !MULTI_BULK(blocks[s]) )
+			continue;
+		multi_keys(ctxs[s],tdes,dec,k);
+		ecb_run(k[0],k[1],k[2],data[s],blocks[s]);
+	}
+	ecb_lanes(ctxs,tdes,dec,data,blocks,n);
+}
 
-	return (i);
+void des_enc_multi(des_ctx **ctxs, unsigned char **data, int *blocks, int n)
+{
+	DES_PROBE2(mode_start, "des-enc-multi", n);
+	ecb_multi((void **)ctxs,0,0,data,blocks,n);
+	DES_PROBE2(mode_end, "des-enc-multi", n);
 }
 
-/* This function will pack an ASCII HEX string into a hex
- * array (which is really a cblock)
- */
-void pack_key(unsigned char * key, unsigned char * deskey)
+void des_dec_multi(des_ctx **ctxs, unsigned char **data, int *blocks, int n)
 {
-   	unsigned int hexint1 = 0;
-   	unsigned int hexint2 = 0;
-   	unsigned int j = 0;
-   	unsigned int c = 0;
-   	int i;
-	unsigned char *tmpkey;
+	DES_PROBE2(mode_start, "des-dec-multi", n);
+	ecb_multi((void **)ctxs,0,1,data,blocks,n);
+	DES_PROBE2(mode_end, "des-dec-multi", n);
+}
 
-	tmpkey = deskey;
+void des3_enc_multi(des3_ctx **ctxs, unsigned char **data, int *blocks, int n)
+{
+	DES_PROBE2(mode_start, "des3-enc-multi", n);
+	ecb_multi((void **)ctxs,1,0,data,blocks,n);
+	DES_PROBE2(mode_end, "des3-enc-multi", n);
+}
 
-   	/* Pack ASCII KEY string into hex array */
-   	j = 0;
-   	for(i=0; i<HEXBLOCK_SIZE; i+=2) {
-		hexint1 = hex2int(key[i]);
-		hexint2 = hex2int(key[i+1]);
-		c = ((hexint1 * 16 ) + hexint2) & 0xFF;
-		//printf("[i: %x 1: 0x%02x 2: 0x%02x c: 0x%02x]\n",i,hexint1,hexint2,c);
-		tmpkey[j] = c;
-	        j++;
-   	}
+void des3_dec_multi(des3_ctx **ctxs, unsigned char **data, int *blocks, int n)
+{
+	DES_PROBE2(mode_start, "des3-dec-multi", n);
+	ecb_multi((void **)ctxs,1,1,data,blocks,n);
+	DES_PROBE2(mode_end, "des3-dec-multi", n);
+}
 
+/* CBC mode. iv is 8 bytes, read as the chaining value and updated to
+   the last ciphertext block, so a long message can be done in several
+   calls. Decryption has every block's input up front, so it runs the
+   ciphertext through the bulk ECB code a chunk at a time and XORs the
+   chaining values in afterwards. */
 
-}
+typedef void (*ecb_fn)(void *, unsigned char *, int);
 
-/* This function will convert a single digit ASCII character
- * (typed as int) representing a hex string digit into the
- * integer value it represents. E.g. 'F' returns (int)15
- */
-int hex2int(int num)
+static void ecb_enc1(void *dc, unsigned char *data, int blocks)
 {
-	int n = 0;
+	des_enc(dc,data,blocks);
+}
 
-	//printf("num: %d\n",num);
-	switch (num) {
+static void ecb_dec1(void *dc, unsigned char *data, int blocks)
+{
+	des_dec(dc,data,blocks);
+}
 
-		case '0':	// 48
-			n = 0;
-			break;
+static void ecb_enc3(void *dc, unsigned char *data, int blocks)
+{
+	des3_enc(dc,data,blocks);
+}
 
-		case '1':	// 49
-			n = 1;
-			break;
+static void ecb_dec3(void *dc, unsigned char *data, int blocks)
+{
+	des3_dec(dc,data,blocks);
+}
 
-		case '2':	// 50
-			n = 2;
-			break;
+/* dst ^= src over bytes bytes, a 64-bit word at a time */
+static void xor_bytes(unsigned char *dst, unsigned char *src, int bytes)
+{
+	uint64_t a, b;
 
-		case '3':	// 51
-			n = 3;
-			break;
+	for( ; bytes >= 8; bytes -= 8, dst += 8, src += 8 )
+	{
+		memcpy(&a,dst,8);
+		memcpy(&b,src,8);
+		a ^= b;
+		memcpy(dst,&a,8);
+	}
+	for( ; bytes > 0; bytes-- )
+		*dst++ ^= *src++;
+}
 
-		case '4':	// 52
-			n = 4;
-			break;
+static void cbc_dec(void *dc, ecb_fn ecb, unsigned char *iv,
+			unsigned char *data, int blocks)
+{
+	unsigned char save[DES_CBC_CHUNK * 8];
+	int n;
 
-		case '5':	// 53
-			n = 5;
-			break;
+	for( ; blocks > 0; blocks -= n, data += n * 8 )
+	{
+		n = blocks < DES_CBC_CHUNK ? blocks : DES_CBC_CHUNK;
+		memcpy(save,data,n * 8);
+		ecb(dc,data,n);
+		xor_bytes(data,iv,8);
+		xor_bytes(data + 8,save,(n - 1) * 8);
+		memcpy(iv,save + (n - 1) * 8,8);
+	}
+}
 
-		case '6':	// 54
-			n = 6;
-			break;
+void des_cbc_enc(des_ctx *dc, unsigned char *iv, unsigned char *data, int blocks)
+{
+	uint32_t work[2], chain[2];
+	int i;
+	DES_PROF_START(t);
 
-		case '7':	// 55
-			n = 7;
-			break;
+	DES_PROBE2(mode_start, "des-cbc-enc", blocks * 8);
+	scrunch(iv,chain);
+	for(i=0;i<blocks;i++)
+	{
+		scrunch(data,work);
+		work[0] ^= chain[0];
+		work[1] ^= chain[1];
+		desfunc(work,dc->ek);
+		unscrun(work,data);
+		chain[0] = work[0];
+		chain[1] = work[1];
+		data+=8;
+	}
+	unscrun(chain,iv);
+	DES_PROBE2(mode_end, "des-cbc-enc", blocks * 8);
+	DES_PROF_END(DES_PROF_CIPHER,t);
+}
 
-		case '8':	// 56
-			n = 8;
-			break;
+void des_cbc_dec(des_ctx *dc, unsigned char *iv, unsigned char *data, int blocks)
+{
+	DES_PROBE2(mode_start, "des-cbc-dec", blocks * 8);
+	cbc_dec(dc,ecb_dec1,iv,data,blocks);
+	DES_PROBE2(mode_end, "des-cbc-dec", blocks * 8);
+}
 
-		case '9':	// 57
-			n = 9;
-			break;
+void des3_cbc_enc(des3_ctx *dc, unsigned char *iv, unsigned char *data, int blocks)
+{
+	uint32_t work[2], chain[2];
+	int i;
+	DES_PROF_START(t);
 
-		case 'A':	// 65
-			n = 10;
-			break;
+	DES_PROBE2(mode_start, "des3-cbc-enc", blocks * 8);
+	scrunch(iv,chain);
+	for(i=0;i<blocks;i++)
+	{
+		scrunch(data,work);
+		work[0] ^= chain[0];
+		work[1] ^= chain[1];
+		desfunc3(work,dc->ek1,dc->dk2,dc->ek3);
+		unscrun(work,data);
+		chain[0] = work[0];
+		chain[1] = work[1];
+		data+=8;
+	}
+	unscrun(chain,iv);
+	DES_PROBE2(mode_end, "des3-cbc-enc", blocks * 8);
+	DES_PROF_END(DES_PROF_CIPHER,t);
+}
 
-		case 'B':	// 66
-			n = 11;
-			break;
+void des3_cbc_dec(des3_ctx *dc, unsigned char *iv, unsigned char *data, int blocks)
+{
+	DES_PROBE2(mode_start, "des3-cbc-dec", blocks * 8);
+	cbc_dec(dc,ecb_dec3,iv,data,blocks);
+	DES_PROBE2(mode_end, "des3-cbc-dec", blocks * 8);
+}
 
-		case 'C':	// 67
-			n = 12;
-			break;
+/* CBC encryption is serial within a stream, but n independent streams
+   under one key can share the bulk kernels: each step gathers the next
+   block of up to DES_CBC_LANES streams, chains it, encrypts them all
+   in one ECB call and scatters them back. A stream that runs out is
+   replaced by the next waiting one, so the batch stays full. ivs[i],
+   data[i] and blocks[i] describe stream i; every iv is updated. */
 
-		case 'D':	// 68
-			n = 13;
-			break;
+static void cbc_enc_multi(void *dc, ecb_fn ecb, unsigned char **ivs,
+			unsigned char **data, int *blocks, int n)
+{
+	unsigned char buf[DES_CBC_LANES * 8];
+	int lane[DES_CBC_LANES], pos[DES_CBC_LANES];
+	int active, next, i, s;
 
-		case 'E':	// 69
-			n = 14;
+	active = 0;
+	next = 0;
+	for(;;)
+	{
+		for( ; active < DES_CBC_LANES && next < n; next++ )
+		{
+			if( blocks[next] <= 0 )
+				continue;
+			lane[active] = next;
+			pos[active] = 0;
+			active++;
+		}
+		if( active == 0 )
 			break;
 
-		case 'F':	// 70
-			n = 15;
-			break;
+		for( i = 0; i < active; i++ )
+		{
+			s = lane[i];
+			memcpy(buf + i * 8,data[s] + pos[i] * 8,8);
+			xor_bytes(buf + i * 8,ivs[s],8);
+		}
+		ecb(dc,buf,active);
+		for( i = 0; i < active; i++ )
+		{
+			s = lane[i];
+			memcpy(data[s] + pos[i] * 8,buf + i * 8,8);
+			memcpy(ivs[s],buf + i * 8,8);
+			pos[i]++;
+		}
 
-		case 'a':	// 97
-			n = 10;
-			break;
+		/* Retire finished streams, keeping the lanes packed */
+		for( i = 0; i < active; )
+		{
+			if( pos[i] < blocks[lane[i]] )
+			{
+				i++;
+				continue;
+			}
+			active--;
+			lane[i] = lane[active];
+			pos[i] = pos[active];
+		}
+	}
+}
 
-		case 'b':	// 98
-			n = 11;
-			break;
+void des_cbc_enc_multi(des_ctx *dc, unsigned char **ivs, unsigned char **data,
+			int *blocks, int n)
+{
+	DES_PROBE2(mode_start, "des-cbc-enc-multi", n);
+	cbc_enc_multi(dc,ecb_enc1,ivs,data,blocks,n);
+	DES_PROBE2(mode_end, "des-cbc-enc-multi", n);
+}
 
-		case 'c':	// 99
-			n = 12;
-			break;
+void des3_cbc_enc_multi(des3_ctx *dc, unsigned char **ivs, unsigned char **data,
+			int *blocks, int n)
+{
+	DES_PROBE2(mode_start, "des3-cbc-enc-multi", n);
+	cbc_enc_multi(dc,ecb_enc3,ivs,data,blocks,n);
+	DES_PROBE2(mode_end, "des3-cbc-enc-multi", n);
+}
 
-		case 'd':	// 100
-			n = 13;
-			break;
+/* CTR mode. ctr is the 8-byte big-endian counter block for the first
+   block of data, and keystream block i is the encryption of ctr + i
+   (mod 2^64). bytes need not be a multiple of 8; ctr is advanced past
+   every block used, a partial last one included. Since any block's
+   keystream depends only on its counter, a message can be done in
+   pieces, in any order or in parallel, by starting each piece from
+   the right counter. The same call encrypts and decrypts. */
 
-		case 'e':	// 101
-			n = 14;
-			break;
+static void ctr_run(uint32_t *k1, uint32_t *k2, uint32_t *k3,
+			unsigned char *ctr, unsigned char *data, int bytes)
+{
+	unsigned char ks[DES_CTR_CHUNK * 8];
+	uint64_t count;
+	int i, j, n;
 
-		case 'f':	// 102
-			n = 15;
-			break;
+	for( count = 0, i = 0; i < 8; i++ )
+		count = (count << 8) | ctr[i];
+	for( ; bytes > 0; bytes -= n * 8, data += n * 8 )
+	{
+		n = (bytes + 7) / 8;
+		if( n > DES_CTR_CHUNK )
+			n = DES_CTR_CHUNK;
+		for( i = 0; i < n; i++, count++ )
+			for( j = 0; j < 8; j++ )
+				ks[i * 8 + j] = (count >> (56 - j * 8)) & 0xff;
+		ecb_run(k1,k2,k3,ks,n);
+		xor_bytes(data,ks,bytes < n * 8 ? bytes : n * 8);
 	}
+	for( i = 7; i >= 0; i--, count >>= 8 )
+		ctr[i] = count & 0xff;
+}
+
+void des_ctr(des_ctx *dc, unsigned char *ctr, unsigned char *data, int bytes)
+{
+	DES_PROBE2(mode_start, "des-ctr", bytes);
+	ctr_run(dc->ek,NULL,NULL,ctr,data,bytes);
+	DES_PROBE2(mode_end, "des-ctr", bytes);
+}
+
+void des3_ctr(des3_ctx *dc, unsigned char *ctr, unsigned char *data, int bytes)
+{
+	DES_PROBE2(mode_start, "des3-ctr", bytes);
+	ctr_run(dc->ek1,dc->dk2,dc->ek3,ctr,data,bytes);
+	DES_PROBE2(mode_end, "des3-ctr", bytes);
+}
+
+/* Set the block count at which des_enc/des_dec/des3_enc/des3_dec
+   switch to the bitsliced engine, 0 to always use the table code */
+
+void des_set_bs_threshold(int blocks)
+{
+	bs_threshold = blocks;
+}
+
+/* Bind the named kernel ("avx512", "avx2", "sse2", "scalar" or
+   "table"). NULL, "" or "auto" picks the best one this CPU supports.
+   Returns 0, or -1 if the kernel is unknown or not supported here.
+   Overrides TESTDES_KERNEL; call it before starting threads */
+
+int des_set_kernel(const char *name)
+{
+	des_kernel *k;
+
+	pthread_once(&kernel_once,kernel_init);
+	k = find_kernel(name);
+	if( k == NULL )
+		return(-1);
+	kernel = k;
+	return(0);
+}
+
+const char *des_kernel_name(void)
+{
+	return(cur_kernel()->name);
+}
+
+/* DESUTILS_VERSION this library was built as */
+int desutils_version(void)
+{
+	return(DESUTILS_VERSION);
+}
+
+/* List the kernels, marking the bound one and any this CPU can't run */
+
+void des_show_kernels(void)
+{
+	des_kernel *k, *cur;
 
-	return (n);
+	cur = cur_kernel();
+	for( k = kernels; k->name != NULL; k++ )
+		printf("%c %-8s %3d lanes%s\n", k == cur ? '*' : ' ', k->name,
+			k->lanes, k->supported() ? "" : " (unsupported)");
 }
 
 /* This method will take the provided des_cblock value
@@ -0,0 +1,40 @@
+/*
+ * libdesutils.h - Public interface of libdesutils
+ *
+ * A program linking libdesutils.a or libdesutils.so includes this
+ * header and nothing else. It brings in the context based API:
+ *
+ *   des_key/des3_key/des3_key3	build a des_ctx or des3_ctx once
+ *   des_enc/des_dec, des3_*	ECB over whole blocks, in place
+ *   des_cbc_*, des3_cbc_*	CBC, the IV updated for the next call
+ *   des_ctr, des3_ctr		CTR, any length, the counter updated
+ *   des_enc_multi, des3_enc_multi	ECB over many buffers, a key each
+ *   des_pool_*, des3_pool_*	the same spread over a thread pool
+ *   des_cache_*		reuse of schedules for repeated keys
+ *   des_hex_*			hex to binary and back
+ *
+ * All of these are reentrant on separate contexts. The library keeps
+ * this API and the layout of des_ctx and des3_ctx for every release
+ * with the same major version; check desutils_version() against
+ * DESUTILS_VERSION at startup to catch a mismatched .so.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ *
+ */
+
+#ifndef __LIBDESUTILS_H__
+#define __LIBDESUTILS_H__
+
+#define DESUTILS_VERSION_MAJOR	1
+#define DESUTILS_VERSION_MINOR	1
+#define DESUTILS_VERSION	((DESUTILS_VERSION_MAJOR << 16) | DESUTILS_VERSION_MINOR)
+
+#include "desutils.h"
+#include "despool.h"
+#include "descache.h"
+#include "deshex.h"
+
+int desutils_version(void);
+
+#endif	// __LIBDESUTILS_H__
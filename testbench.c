@@ -0,0 +1,344 @@
+/*
+ * testbench.c - Built in benchmarks for the DES Test Program
+ *
+ * do_bench() times key setup, single block latency, bulk ECB, CBC and
+ * CTR at several buffer sizes for single and Triple DES, and ECB
+ * scaling over the thread pool. Every case is calibrated to take about
+ * BENCH_REP_NS per repetition, warmed up once, then run reps times;
+ * the median and 99th percentile of those repetitions are reported.
+ *
+ * Cycles come from the TSC on x86, so they are reference cycles at the
+ * TSC rate rather than core clocks; elsewhere they are not reported.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+#include "testdes.h"
+#include "desutils.h"
+#include "despool.h"
+#include "deshex.h"
+
+#ifdef DES_X86_KERNELS
+#include <x86intrin.h>
+#define bench_tsc()	((double)__rdtsc())
+#define BENCH_HAVE_TSC	1
+#else
+#define bench_tsc()	0.0
+#define BENCH_HAVE_TSC	0
+#endif
+
+#define BENCH_REP_NS	20e6		/* Target time per repetition */
+#define BENCH_REPS	11		/* Repetitions by default */
+#define BENCH_SCALE_BUF	(4 << 20)	/* Buffer for the thread scaling runs */
+
+/* One case: run iters operations of bytes each (0 for key setup) */
+typedef struct {
+	const char *name;
+	int tdes;		/* 0 = single DES, 1 = two-key, 2 = three-key */
+	int op;			/* BENCH_* */
+	long bytes;
+	des_pool *pool;
+} bench_case;
+
+enum {
+	BENCH_KEY,
+	BENCH_ECB_ENC,
+	BENCH_ECB_DEC,
+	BENCH_CBC_ENC,
+	BENCH_CBC_DEC,
+	BENCH_CTR,
+	BENCH_POOL_ECB
+};
+
+static des_ctx bdc;
+static des3_ctx bd3;
+static unsigned char *bbuf;
+static unsigned char biv[8];
+static unsigned char bkey[24] = {
+	0x01,0x23,0x45,0x67,0x89,0xab,0xcd,0xef,
+	0x23,0x45,0x67,0x89,0xab,0xcd,0xef,0x01,
+	0x45,0x67,0x89,0xab,0xcd,0xef,0x01,0x23 };
+static volatile uint32_t bench_sink;
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* Run iters operations of case bc */
+static void bench_ops(bench_case *bc, long iters)
+{
+	long i, blocks;
+
+	blocks = bc->bytes / CBLOCK_SIZE;
+	for (i=0;i<iters;i++)
+	{
+		switch (bc->op)
+		{
+			case BENCH_KEY:
+				/* Vary the key so no setup can be hoisted */
+				bkey[7] = i;
+				if (bc->tdes == 2)
+					des3_key3(&bd3,bkey);
+				else if (bc->tdes)
+					des3_key(&bd3,bkey);
+				else
+					des_key(&bdc,bkey);
+				break;
+			case BENCH_ECB_ENC:
+				if (bc->tdes)
+					des3_enc(&bd3,bbuf,blocks);
+				else
+					des_enc(&bdc,bbuf,blocks);
+				break;
+			case BENCH_ECB_DEC:
+				if (bc->tdes)
+					des3_dec(&bd3,bbuf,blocks);
+				else
+					des_dec(&bdc,bbuf,blocks);
+				break;
+			case BENCH_CBC_ENC:
+				if (bc->tdes)
+					des3_cbc_enc(&bd3,biv,bbuf,blocks);
+				else
+					des_cbc_enc(&bdc,biv,bbuf,blocks);
+				break;
+			case BENCH_CBC_DEC:
+				if (bc->tdes)
+					des3_cbc_dec(&bd3,biv,bbuf,blocks);
+				else
+					des_cbc_dec(&bdc,biv,bbuf,blocks);
+				break;
+			case BENCH_CTR:
+				if (bc->tdes)
+					des3_ctr(&bd3,biv,bbuf,bc->bytes);
+				else
+					des_ctr(&bdc,biv,bbuf,bc->bytes);
+				break;
+			case BENCH_POOL_ECB:
+				des3_pool_enc(bc->pool,&bd3,bbuf,blocks);
+				break;
+		}
+	}
+	bench_sink += bbuf[0] + bdc.ek[0] + bd3.ek3[0];
+}
+
+/* Time case bc and print (or add to the JSON array) one result line */
+static void bench_run(bench_case *bc, int reps, int json, int *first)
+{
+	double *ns, *cyc, t, c, med, p99, cmed, ops, mbs;
+	long iters;
+	int i;
+
+	ns = malloc(reps * sizeof(double));
+	cyc = malloc(reps * sizeof(double));
+	if (ns == NULL || cyc == NULL)
+	{
+		fprintf(stderr,"out of memory!\n");
+		exit(1);
+	}
+
+	/* Calibrate: double iters until one pass takes a tenth of a rep */
+	for (iters=1;;iters*=2)
+	{
+		t = bench_now();
+		bench_ops(bc,iters);
+		t = bench_now() - t;
+		if (t >= BENCH_REP_NS / 10)
+			break;
+	}
+	iters = iters * (BENCH_REP_NS / t);
+	if (iters < 1)
+		iters = 1;
+
+	/* Warm up, then the timed repetitions */
+	bench_ops(bc,iters);
+	for (i=0;i<reps;i++)
+	{
+		c = bench_tsc();
+		t = bench_now();
+		bench_ops(bc,iters);
+		t = bench_now() - t;
+		c = bench_tsc() - c;
+		ns[i] = t / iters;
+		cyc[i] = c / iters;
+	}
+	qsort(ns,reps,sizeof(double),cmp_double);
+	qsort(cyc,reps,sizeof(double),cmp_double);
+	med = ns[reps / 2];
+	p99 = ns[(reps * 99 + 99) / 100 - 1];
+	cmed = cyc[reps / 2];
+	ops = 1e9 / med;
+	mbs = bc->bytes * ops / 1e6;
+
+	if (json)
+	{
+		printf("%s\n    {\"name\": \"%s\", \"threads\": %d, \"bytes\": %ld, "
+			"\"iters\": %ld, \"ops_per_sec\": %.1f, \"ns_per_op_median\": %.2f, "
+			"\"ns_per_op_p99\": %.2f, ",
+			*first ? "" : ",",bc->name,des_pool_threads(bc->pool),
+			bc->bytes,iters,ops,med,p99);
+		if (bc->bytes)
+			printf("\"mb_per_sec\": %.2f, ",mbs);
+		else
+			printf("\"mb_per_sec\": null, ");
+		if (BENCH_HAVE_TSC)
+			printf("\"cycles_per_op\": %.1f, \"cycles_per_byte\": ",cmed);
+		else
+			printf("\"cycles_per_op\": null, \"cycles_per_byte\": ");
+		if (BENCH_HAVE_TSC && bc->bytes)
+			printf("%.2f}",cmed / bc->bytes);
+		else
+			printf("null}");
+		*first = 0;
+	} else {
+		printf("%-16s %3d %8ld %12.0f %12.1f %12.1f",bc->name,
+			des_pool_threads(bc->pool),bc->bytes,ops,med,p99);
+		if (bc->bytes)
+			printf(" %9.2f",mbs);
+		else
+			printf(" %9s","-");
+		if (BENCH_HAVE_TSC && bc->bytes)
+			printf(" %8.2f\n",cmed / bc->bytes);
+		else if (BENCH_HAVE_TSC)
+			printf(" %8.0f/op\n",cmed);
+		else
+			printf(" %8s\n","-");
+	}
+	fflush(stdout);
+	free(ns);
+	free(cyc);
+}
+
+/* Run the whole suite. reps is the repetitions per case (0 for the
+ * default), maxthreads the most threads for the scaling runs (0 for
+ * one per CPU). Output is a table, or JSON if json is set. Returns
+ * the exit status.
+ */
+int do_bench(int json, int reps, int maxthreads)
+{
+	static const long sizes[] = { 1024, 64 * 1024, 1024 * 1024 };
+	static const struct { const char *name; int op; } modes[] = {
+		{ "ecb-enc", BENCH_ECB_ENC },
+		{ "ecb-dec", BENCH_ECB_DEC },
+		{ "cbc-enc", BENCH_CBC_ENC },
+		{ "cbc-dec", BENCH_CBC_DEC },
+		{ "ctr",     BENCH_CTR } };
+	static const char *ciphers[] = { "des", "tdes" };
+	char names[5 * 2][16];
+	bench_case bc;
+	struct utsname un;
+	long ncpu;
+	size_t k;
+	int i, j, t, first = 1;
+
+	if (reps <= 0)
+		reps = BENCH_REPS;
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpu < 1)
+		ncpu = 1;
+	if (maxthreads <= 0)
+		maxthreads = ncpu;
+
+	bbuf = malloc(BENCH_SCALE_BUF);
+	if (bbuf == NULL)
+	{
+		fprintf(stderr,"out of memory!\n");
+		return(1);
+	}
+	memset(bbuf,0x5a,BENCH_SCALE_BUF);
+	des_key(&bdc,bkey);
+	des3_key(&bd3,bkey);
+
+	uname(&un);
+	if (json)
+	{
+		printf("{\n  \"version\": \"%d.%d\",\n  \"machine\": \"%s\",\n"
+			"  \"cpus\": %ld,\n  \"kernel\": \"%s\",\n  \"hex\": \"%s\",\n"
+			"  \"reps\": %d,\n  \"tsc\": %s,\n  \"results\": [",
+			VER_MAJOR,VER_MINOR,un.machine,ncpu,des_kernel_name(),
+			des_hex_impl(),reps,BENCH_HAVE_TSC ? "true" : "false");
+	} else {
+		printf("testdes %d.%d on %s, %ld CPUs, kernel %s, %d reps per case\n",
+			VER_MAJOR,VER_MINOR,un.machine,ncpu,des_kernel_name(),reps);
+		printf("%-16s %3s %8s %12s %12s %12s %9s %8s\n","case","thr","bytes",
+			"ops/s","ns/op","p99 ns/op","MB/s","cyc/B");
+	}
+
+	memset(&bc,0x00,sizeof(bc));
+
+	/* Key setup */
+	bc.op = BENCH_KEY;
+	bc.bytes = 0;
+	bc.name = "des-key";
+	bc.tdes = 0;
+	bench_run(&bc,reps,json,&first);
+	bc.name = "tdes-key";
+	bc.tdes = 1;
+	bench_run(&bc,reps,json,&first);
+	bc.name = "tdes3-key";
+	bc.tdes = 2;
+	bench_run(&bc,reps,json,&first);
+	des3_key(&bd3,bkey);
+
+	/* Single block latency */
+	bc.op = BENCH_ECB_ENC;
+	bc.bytes = CBLOCK_SIZE;
+	bc.name = "des-block";
+	bc.tdes = 0;
+	bench_run(&bc,reps,json,&first);
+	bc.name = "tdes-block";
+	bc.tdes = 1;
+	bench_run(&bc,reps,json,&first);
+
+	/* Bulk, each cipher, mode and size */
+	for (i=0;i<2;i++)
+	{
+		for (j=0;j<5;j++)
+		{
+			snprintf(names[i * 5 + j],sizeof(names[0]),"%s-%s",ciphers[i],modes[j].name);
+			for (k=0;k<sizeof(sizes)/sizeof(sizes[0]);k++)
+			{
+				bc.name = names[i * 5 + j];
+				bc.tdes = i;
+				bc.op = modes[j].op;
+				bc.bytes = sizes[k];
+				bench_run(&bc,reps,json,&first);
+			}
+		}
+	}
+
+	/* Thread scaling, TDES ECB over the pool */
+	bc.name = "tdes-ecb-pool";
+	bc.tdes = 1;
+	bc.op = BENCH_POOL_ECB;
+	bc.bytes = BENCH_SCALE_BUF;
+	for (t=1;t<=maxthreads;t=(t*2>maxthreads && t<maxthreads) ? maxthreads : t*2)
+	{
+		bc.pool = t > 1 ? des_pool_create(t) : NULL;
+		bench_run(&bc,reps,json,&first);
+		des_pool_destroy(bc.pool);
+	}
+
+	if (json)
+		printf("\n  ]\n}\n");
+	free(bbuf);
+	return(0);
+}
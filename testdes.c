@@ -32,8 +32,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "testdes.h"
 #include "desutils.h"
+#include "despool.h"
+#include "desfile.h"
+#include "deshex.h"
+#include "desprof.h"
+#include "desserve.h"
 
 #define HEXKEY_SIZE HEXBLOCK_SIZE+1					// Enough room for 16 hex digits and \0
 #define HEXKEY_TSIZE (HEXBLOCK_SIZE * 2) + 1		// Enough room for 32 hex digits and \0
@@ -44,6 +53,25 @@ static int debug = 0;		// When set to 1, debugging output occurs
 static int quiet = 0;		// When set to 1, suppresses all extraneous output
 static int mode = 0;		// Controls DES mode, 0 = SDES, 1 = TDES
 static int action = 0;		// Determins what action occurs, 0 = decrypt, 1 = encrypt
+static int threads = -1;	// Worker threads for bulk operations, 0 = one per CPU, -1 = not given
+static des_pool *pool = NULL;	// Thread pool, when threads != 1
+static int chain = DES_ECB;	// Chaining for multi-block data, DES_ECB, DES_CBC or DES_CTR
+static unsigned char * hexiv = "0000000000000000";	// CBC IV or CTR counter, 16 hex digits
+static char * infile = NULL;	// File to crypt, "-" for stdin
+static char * outfile = NULL;	// Where it goes, "-" for stdout
+static int padding = DES_PAD_PKCS5;	// File padding for ECB and CBC
+static int usemmap = 0;		// When set to 1, files are memory mapped
+static int async = -1;		// File I/O engine, DES_AIO_*, -1 = plain loop
+static int depth = 0;		// Buffers in flight with --async, 0 = default
+static int batch = 0;		// When set to 1, runs key/data lines from batchfile
+static char * batchfile = NULL;	// Batch input, NULL or "-" for stdin
+static int cachesize = DES_CACHE_SIZE;	// Key schedules cached in batch mode, 0 = none
+static int stats = 0;		// When set to 1, prints key cache counters
+static int bench = 0;		// When set to 1, runs the benchmark suite
+static int json = 0;		// When set to 1, benchmark results are JSON
+static int reps = 0;		// Benchmark repetitions per case, 0 = default
+static int kat = 0;		// When set to 1, runs the known answer tests
+static char * servepath = NULL;	// Unix socket to serve requests on, NULL = don't
 
 // Set some enums for actions
 enum Actions {
@@ -78,19 +106,35 @@ int getKeySize(int tmode)
 	return(-1);
 }
 
+/* This function returns 1 if a hex key of size
+ * digits can be used in the specified DES mode.
+ * Triple DES takes two keys (K3 = K1) or three.
+ */
+int checkKeySize(int tmode, int size)
+{
+	if (size == getKeySize(tmode))
+		return(1);
+	if (tmode == MODE_TDES && size == HEXBLOCK_SIZE * 3)
+		return(1);
+	return(0);
+}
+
 /* Function to show the contents of a binary BLOCK
  * to the screen with a label. Useful for debugging
  * crypt  activities
  */
 void show_key(char * name, unsigned char * key)
 {
-	int i;
+	char hex[HEXBLOCK_SIZE + 2];
+	DES_PROF_START(t);
+
 	/* Show key1 to user */
 	if (name != "")
 		printf("%s ",name);
-	for(i=0;i<CBLOCK_SIZE;i++)
-		printf("%02X",key[i]);
-	printf("\n");
+	des_hex_encode(key,hex,CBLOCK_SIZE);
+	hex[HEXBLOCK_SIZE] = '\n';
+	fwrite(hex,1,HEXBLOCK_SIZE + 1,stdout);
+	DES_PROF_END(DES_PROF_OUTPUT,t);
 
 //	printf("%s: ",name);
 //	for(i=0;i<8;i++)
@@ -99,6 +143,59 @@ void show_key(char * name, unsigned char * key)
 
 }
 
+/* Function to show one or more binary blocks to the
+ * screen as a single hex string with a label.
+ */
+void show_data(char * name, unsigned char * data, int blocks)
+{
+	char hex[1024];
+	long i, n;
+	DES_PROF_START(t);
+
+	if (name != "")
+		printf("%s ",name);
+	for(i=0;i<(long)blocks*CBLOCK_SIZE;i+=n)
+	{
+		n = (long)blocks*CBLOCK_SIZE - i;
+		if (n > sizeof(hex) / 2)
+			n = sizeof(hex) / 2;
+		des_hex_encode(&data[i],hex,n);
+		fwrite(hex,1,n * 2,stdout);
+	}
+	printf("\n");
+	DES_PROF_END(DES_PROF_OUTPUT,t);
+}
+
+/* Function to pack a hex string of one or more 16 digit
+ * blocks into a newly allocated buffer, returned in data.
+ * Returns the number of blocks, or -1 if the string is
+ * not a whole number of blocks.
+ */
+int pack_data(unsigned char * hexdata, unsigned char ** data)
+{
+	int i, blocks, bad;
+	unsigned char *cp;
+
+	i = strlen(hexdata);
+	if (i == 0 || i % HEXBLOCK_SIZE != 0)
+		return(-1);
+	blocks = i / HEXBLOCK_SIZE;
+
+	cp = malloc(blocks * CBLOCK_SIZE);
+	if (cp == NULL)
+		return(-1);
+	/* Stray non-hex digits pack as 0, as they always have */
+	DES_PROF_START(t);
+	bad = des_hex_decode(hexdata,cp,blocks * CBLOCK_SIZE);
+	DES_PROF_END(DES_PROF_PARSE,t);
+	if (bad != 0)
+		for(i=0;i<blocks;i++)
+			pack_key(&hexdata[i * HEXBLOCK_SIZE],&cp[i * CBLOCK_SIZE]);
+
+	*data = cp;
+	return(blocks);
+}
+
 /* Function to accomplish a standardized set of tests of SDES
  * functionality. Given a known set of keys (111111111111111)
  * & (3333333333333333) and a known start vector (0000000000000000)
@@ -230,11 +327,10 @@ void do_sdes_tests(unsigned char * hexdata, unsigned char * hexkey)
  */
  void do_tdes_tests(unsigned char * hexdata,unsigned char * hexkey)
 {
-	des_ctx dc;
+	des3_ctx dc;
 	unsigned char *cp;
 	unsigned char block[CBLOCK_SIZE];
-	unsigned char key1[CBLOCK_SIZE];
-	unsigned char key2[CBLOCK_SIZE];
+	unsigned char key[CBLOCK_SIZE * 2];
 	unsigned char hexkey1[HEXKEY_SIZE];
 	unsigned char hexkey2[HEXKEY_SIZE];
 	int start;
@@ -262,18 +358,18 @@ void do_sdes_tests(unsigned char * hexdata, unsigned char * hexkey)
 	}
 
 	/* Pack Hexkey into key */
-	pack_key(hexkey1,key1);
+	pack_key(hexkey1,key);
 
 	/* Show key1 to user */
 	if (debug)
-		show_key("Key1:",key1);
+		show_key("Key1:",key);
 
 	/* Pack Hexkey into key */
-	pack_key(hexkey2,key2);
+	pack_key(hexkey2,&key[CBLOCK_SIZE]);
 
  	/* Show key2 to user */
 	if (debug)
-	 	show_key("Key2:",key2);
+	 	show_key("Key2:",&key[CBLOCK_SIZE]);
 
 	/* Pack hexdata into data */
 	pack_key(hexdata,block);
@@ -285,23 +381,11 @@ void do_sdes_tests(unsigned char * hexdata, unsigned char * hexkey)
 	/* Initialize CP */
 	cp = block;
 
-	/* Setup key structure for key1 */
-	des_key(&dc,key1);
+	/* Setup key structure for key1,key2 */
+	des3_key(&dc,key);
 
-	/* Do first action, DES Encrypt Data with Key1 */
-	des_enc(&dc,cp,1);
-
-	/* Setup key structure for key2 */
-	des_key(&dc,key2);
-
-	/* Do second action, DES Decrypt previous result with Key2 */
-	des_dec(&dc,cp,1);
-
-	/* Setup key structure for key1 again */
-	des_key(&dc,key1);
-
-	/* Do third and last action, DES Encrypt Data with Key1 */
-	des_enc(&dc,cp,1);
+	/* TDES Encrypt Data, E(Key1), D(Key2), E(Key1) */
+	des3_enc(&dc,cp,1);
 
 	/* Show results */
 	if (quiet == 1)
@@ -312,15 +396,19 @@ void do_sdes_tests(unsigned char * hexdata, unsigned char * hexkey)
 
 /* Function to accomplish an SDES Decrypt on a block of data
  * Data and key are provided as 16 digit ASCII hex strings.
+ * Data may be several blocks long, which are done in ECB,
+ * CBC or CTR.
  */
 void do_sdes_dec(unsigned char * hexdata, unsigned char * hexkey)
 {
 	des_ctx dc;
 	unsigned char *cp;
-	unsigned char x[CBLOCK_SIZE];
+	int blocks;
+	unsigned char *x;
 	unsigned char key[CBLOCK_SIZE];
+	unsigned char iv[CBLOCK_SIZE];
 
-	if (strlen(hexkey) != getKeySize(mode))
+	if (!checkKeySize(mode,strlen(hexkey)))
 	{
 		printf("hexkey size not correct for mode!\n");
 		return;
@@ -339,12 +427,20 @@ void do_sdes_dec(unsigned char * hexdata, unsigned char * hexkey)
 	if (debug)
 		show_key("Key:",key);
 
-	/* Pack hexdata into data */
-	pack_key(hexdata,x);
+	/* Pack hexdata into data, one or more blocks */
+	blocks = pack_data(hexdata,&x);
+	if (blocks < 0)
+	{
+		printf("hexdata size not a multiple of %d!\n",HEXBLOCK_SIZE);
+		return;
+	}
 
 	/* Show data to user */
 	if (debug)
-		show_key("Data:",x);
+		show_data("Data:",x,blocks);
+
+	/* Pack hexiv into iv, used by CBC and CTR */
+	pack_key(hexiv,iv);
 
 	/* Initialize CP */
 	cp = x;
@@ -353,27 +449,37 @@ void do_sdes_dec(unsigned char * hexdata, unsigned char * hexkey)
 	des_key(&dc,key);
 
 	/* Do first action, DES Encrypt Data with Key */
-	des_dec(&dc,cp,1);
+	if (chain == DES_CTR)
+		des_pool_ctr(pool,&dc,iv,cp,blocks * CBLOCK_SIZE);
+	else if (chain == DES_CBC)
+		des_pool_cbc_dec(pool,&dc,iv,cp,blocks);
+	else
+		des_pool_dec(pool,&dc,cp,blocks);
 
 	/* Show results */
 	if (quiet == 1)
-		show_key("SDES Dec(key) = ",cp);
+		show_data("SDES Dec(key) = ",cp,blocks);
 	else
-		show_key("",cp);
+		show_data("",cp,blocks);
 
+	free(x);
 }
 
 /* Function to accomplish an SDES Encrypt on a block of data
  * Data and key are provided as 16 digit ASCII hex strings.
+ * Data may be several blocks long, which are done in ECB,
+ * CBC or CTR.
  */
 void do_sdes_enc(unsigned char * hexdata, unsigned char * hexkey)
 {
 	des_ctx dc;
 	unsigned char *cp;
-	unsigned char x[CBLOCK_SIZE];
+	int blocks;
+	unsigned char *x;
 	unsigned char key[CBLOCK_SIZE];
+	unsigned char iv[CBLOCK_SIZE];
 
-	if (strlen(hexkey) != getKeySize(mode))
+	if (!checkKeySize(mode,strlen(hexkey)))
 	{
 		printf("hexkey size not correct for mode!\n");
 		return;
@@ -392,12 +498,20 @@ void do_sdes_enc(unsigned char * hexdata, unsigned char * hexkey)
 	if (debug)
 		show_key("Key:",key);
 
-	/* Pack hexdata into data */
-	pack_key(hexdata,x);
+	/* Pack hexdata into data, one or more blocks */
+	blocks = pack_data(hexdata,&x);
+	if (blocks < 0)
+	{
+		printf("hexdata size not a multiple of %d!\n",HEXBLOCK_SIZE);
+		return;
+	}
 
 	/* Show data to user */
 	if (debug)
-		show_key("Data:",x);
+		show_data("Data:",x,blocks);
+
+	/* Pack hexiv into iv, used by CBC and CTR */
+	pack_key(hexiv,iv);
 
 	/* Initialize CP */
 	cp = x;
@@ -406,32 +520,41 @@ void do_sdes_enc(unsigned char * hexdata, unsigned char * hexkey)
 	des_key(&dc,key);
 
 	/* Do first action, DES Encrypt Data with Key */
-	des_enc(&dc,cp,1);
+	if (chain == DES_CTR)
+		des_pool_ctr(pool,&dc,iv,cp,blocks * CBLOCK_SIZE);
+	else if (chain == DES_CBC)
+		des_cbc_enc(&dc,iv,cp,blocks);
+	else
+		des_pool_enc(pool,&dc,cp,blocks);
 
 	/* Show results */
 	if (quiet == 1)
-		show_key("SDES Enc(key) = ",cp);
+		show_data("SDES Enc(key) = ",cp,blocks);
 	else
-		show_key("",cp);
+		show_data("",cp,blocks);
 
+	free(x);
 }
 
 /* Function to accomplish a TDES Decrypt on a block of data
  * Data is provided as 16 digit ASCII hex string, key as a
- * 32 digit ASCII hex string.
+ * 32 or 48 digit ASCII hex string. Data may be several blocks long,
+ * which are done in ECB, CBC or CTR.
  */
 void do_tdes_dec(unsigned char * hexdata, unsigned char * hexkey)
 {
-	des_ctx dc;
+	des3_ctx dc;
 	unsigned char *cp;
-	unsigned char x[CBLOCK_SIZE];
-	unsigned char key1[CBLOCK_SIZE];
-	unsigned char key2[CBLOCK_SIZE];
+	int blocks;
+	unsigned char *x;
+	unsigned char key[CBLOCK_SIZE * 3];
+	unsigned char iv[CBLOCK_SIZE];
 	unsigned char hexkey1[HEXKEY_SIZE];
 	unsigned char hexkey2[HEXKEY_SIZE];
-	int start;
+	unsigned char hexkey3[HEXKEY_SIZE];
+	int start, keys;
 
-	if (strlen(hexkey) != getKeySize(mode))
+	if (!checkKeySize(mode,strlen(hexkey)))
 	{
 		printf("hexkey size not correct for mode!\n");
 		return;
@@ -445,80 +568,101 @@ void do_tdes_dec(unsigned char * hexdata, unsigned char * hexkey)
 	memset(hexkey2,0x00,sizeof(hexkey2));
 	strncpy(hexkey2,&hexkey[start],HEXBLOCK_SIZE);
 
+	// A 48 digit key carries K3 as well
+	keys = strlen(hexkey) / HEXBLOCK_SIZE;
+	start = HEXBLOCK_SIZE * 2;
+	memset(hexkey3,0x00,sizeof(hexkey3));
+	if (keys == 3)
+		strncpy(hexkey3,&hexkey[start],HEXBLOCK_SIZE);
+
 	if (debug)
 	{
 		printf("%s: '%s'\n","hexdata",hexdata);
 		printf("%s: '%s'\n","hexkey",hexkey);
 		printf("%s: '%s'\n","hexkey1",hexkey1);
 		printf("%s: '%s'\n","hexkey2",hexkey2);
+		if (keys == 3)
+			printf("%s: '%s'\n","hexkey3",hexkey3);
 	}
 
 	/* Pack Hexkey into key */
-	pack_key(hexkey1,key1);
+	pack_key(hexkey1,key);
 
 	/* Show key1 to user */
 	if (debug)
-		show_key("Key1:",key1);
+		show_key("Key1:",key);
 
 	/* Pack Hexkey into key */
-	pack_key(hexkey2,key2);
+	pack_key(hexkey2,&key[CBLOCK_SIZE]);
 
  	/* Show key2 to user */
 	if (debug)
-		show_key("Key2:",key2);
+		show_key("Key2:",&key[CBLOCK_SIZE]);
 
-	/* Restore X by Packing hexdata into data */
-	pack_key(hexdata,x);
+	/* Pack hexdata into data, one or more blocks */
+	blocks = pack_data(hexdata,&x);
+	if (blocks < 0)
+	{
+		printf("hexdata size not a multiple of %d!\n",HEXBLOCK_SIZE);
+		return;
+	}
 
 	/* Show data to user */
 	if (debug)
-		show_key("Data:",x);
+		show_data("Data:",x,blocks);
+
+	/* Pack hexiv into iv, used by CBC and CTR */
+	pack_key(hexiv,iv);
 
 	/* Initialize CP */
 	cp = x;
 
-	/* Setup key structure for key1 */
-	des_key(&dc,key1);
-
-	/* Do first action, DES Encrypt Data with Key1 */
-	des_dec(&dc,cp,1);
-
-	/* Setup key structure for key2 */
-	des_key(&dc,key2);
-
-	/* Do second action, DES Decrypt previous result with Key2 */
-	des_enc(&dc,cp,1);
-
-	/* Setup key structure for key1 again */
-	des_key(&dc,key1);
-
-	/* Do third and last action, DES Encrypt Data with Key1 */
-	des_dec(&dc,cp,1);
+	/* Setup key structure for key1,key2[,key3] */
+	if (keys == 3)
+	{
+		pack_key(hexkey3,&key[CBLOCK_SIZE * 2]);
+		if (debug)
+			show_key("Key3:",&key[CBLOCK_SIZE * 2]);
+		des3_key3(&dc,key);
+	} else
+		des3_key(&dc,key);
+
+	/* TDES Decrypt Data, D(Key3), E(Key2), D(Key1), Key3 = Key1 for two keys */
+	if (chain == DES_CTR)
+		des3_pool_ctr(pool,&dc,iv,cp,blocks * CBLOCK_SIZE);
+	else if (chain == DES_CBC)
+		des3_pool_cbc_dec(pool,&dc,iv,cp,blocks);
+	else
+		des3_pool_dec(pool,&dc,cp,blocks);
 
 	/* Show results */
 	if (quiet == 1)
-		show_key("TDES Dec(Key1,Key2) = ",cp);
+		show_data(keys == 3 ? "TDES Dec(Key1,Key2,Key3) = " : "TDES Dec(Key1,Key2) = ",cp,blocks);
 	else
-		show_key("",cp);
+		show_data("",cp,blocks);
 
+	free(x);
 }
 
 /* Function to accomplish a TDES Encrypt on a block of data
  * Data is provided as 16 digit ASCII hex string, key as a
- * 32 digit ASCII hex string.
+ * 32 or 48 digit ASCII hex string. Data may be several blocks long,
+ * which are done in ECB, CBC or CTR.
  */
 void do_tdes_enc(unsigned char * hexdata, unsigned char * hexkey)
 {
-	des_ctx dc;
+	des3_ctx dc;
 	unsigned char *cp;
-	unsigned char x[CBLOCK_SIZE];
-	unsigned char key1[CBLOCK_SIZE];
-	unsigned char key2[CBLOCK_SIZE];
+	int blocks;
+	unsigned char *x;
+	unsigned char key[CBLOCK_SIZE * 3];
+	unsigned char iv[CBLOCK_SIZE];
 	unsigned char hexkey1[HEXKEY_SIZE];
 	unsigned char hexkey2[HEXKEY_SIZE];
-	int start;
+	unsigned char hexkey3[HEXKEY_SIZE];
+	int start, keys;
 
-	if (strlen(hexkey) != getKeySize(mode))
+	if (!checkKeySize(mode,strlen(hexkey)))
 	{
 		printf("hexkey size not correct for mode!\n");
 		return;
@@ -532,62 +676,417 @@ void do_tdes_enc(unsigned char * hexdata, unsigned char * hexkey)
 	memset(hexkey2,0x00,sizeof(hexkey2));
 	strncpy(hexkey2,&hexkey[start],HEXBLOCK_SIZE);
 
+	// A 48 digit key carries K3 as well
+	keys = strlen(hexkey) / HEXBLOCK_SIZE;
+	start = HEXBLOCK_SIZE * 2;
+	memset(hexkey3,0x00,sizeof(hexkey3));
+	if (keys == 3)
+		strncpy(hexkey3,&hexkey[start],HEXBLOCK_SIZE);
+
 	if (debug)
 	{
 		printf("%s: '%s'\n","hexdata",hexdata);
 		printf("%s: '%s'\n","hexkey",hexkey);
 		printf("%s: '%s'\n","hexkey1",hexkey1);
 		printf("%s: '%s'\n","hexkey2",hexkey2);
+		if (keys == 3)
+			printf("%s: '%s'\n","hexkey3",hexkey3);
 	}
 
 	/* Pack Hexkey into key */
-	pack_key(hexkey1,key1);
+	pack_key(hexkey1,key);
 
 	/* Show key1 to user */
 	if (debug)
-		show_key("Key1:",key1);
+		show_key("Key1:",key);
 
 	/* Pack Hexkey into key */
-	pack_key(hexkey2,key2);
+	pack_key(hexkey2,&key[CBLOCK_SIZE]);
 
 	/* Show key2 to user */
 	if (debug)
-		show_key("Key2:",key2);
+		show_key("Key2:",&key[CBLOCK_SIZE]);
 
-	/* Restore X by Packing hexdata into data */
-	pack_key(hexdata,x);
+	/* Pack hexdata into data, one or more blocks */
+	blocks = pack_data(hexdata,&x);
+	if (blocks < 0)
+	{
+		printf("hexdata size not a multiple of %d!\n",HEXBLOCK_SIZE);
+		return;
+	}
 
 	/* Show Data to user */
 	if (debug)
-		show_key("Data:",x);
+		show_data("Data:",x,blocks);
+
+	/* Pack hexiv into iv, used by CBC and CTR */
+	pack_key(hexiv,iv);
 
 	/* Initialize CP */
 	cp = x;
 
-	/* Setup key structure for key1 */
-	des_key(&dc,key1);
+	/* Setup key structure for key1,key2[,key3] */
+	if (keys == 3)
+	{
+		pack_key(hexkey3,&key[CBLOCK_SIZE * 2]);
+		if (debug)
+			show_key("Key3:",&key[CBLOCK_SIZE * 2]);
+		des3_key3(&dc,key);
+	} else
+		des3_key(&dc,key);
+
+	/* TDES Encrypt Data, E(Key1), D(Key2), E(Key3), Key3 = Key1 for two keys */
+	if (chain == DES_CTR)
+		des3_pool_ctr(pool,&dc,iv,cp,blocks * CBLOCK_SIZE);
+	else if (chain == DES_CBC)
+		des3_cbc_enc(&dc,iv,cp,blocks);
+	else
+		des3_pool_enc(pool,&dc,cp,blocks);
 
-	/* Do first action, DES Encrypt Data with Key1 */
-	des_enc(&dc,cp,1);
+	/* Show results */
+	if (quiet == 1)
+		show_data(keys == 3 ? "TDES Enc(Key1,Key2,Key3) = " : "TDES Enc(Key1,Key2) = ",cp,blocks);
+	else
+		show_data("",cp,blocks);
 
-	/* Setup key structure for key2 */
-	des_key(&dc,key2);
+	free(x);
+}
 
-	/* Do second action, DES Decrypt previous result with Key2 */
-	des_dec(&dc,cp,1);
+/* Function to encrypt or decrypt a whole file, of any length, in
+ * the selected mode, action and chaining. --in and --out name the
+ * files; either one left out, or given as "-", is stdin or stdout.
+ * Messages go to stderr, as stdout may be carrying the data.
+ * Returns the exit status.
+ */
+int do_file(unsigned char * hexkey)
+{
+	des_ctx dc;
+	des3_ctx d3;
+	des_file f;
+	unsigned char key[CBLOCK_SIZE * 3];
+	struct stat ist, ost;
+	int in, out, err;
 
-	/* Setup key structure for key1 again */
-	des_key(&dc,key1);
+	if (!checkKeySize(mode,strlen(hexkey)))
+	{
+		fprintf(stderr,"hexkey size not correct for mode!\n");
+		return(1);
+	}
 
-	/* Do third and last action, DES Encrypt Data with Key1 */
-	des_enc(&dc,cp,1);
+	memset(&f,0x00,sizeof(f));
 
-	/* Show results */
-	if (quiet == 1)
-		show_key("TDES Enc(Key1,Key2) = ",cp);
+	/* Pack Hexkey into key and setup key structure */
+	pack_key(hexkey,key);
+	if (mode == MODE_TDES)
+	{
+		pack_key(&hexkey[HEXBLOCK_SIZE],&key[CBLOCK_SIZE]);
+		if (strlen(hexkey) == HEXBLOCK_SIZE * 3)
+		{
+			pack_key(&hexkey[HEXBLOCK_SIZE * 2],&key[CBLOCK_SIZE * 2]);
+			des3_key3(&d3,key);
+		} else
+			des3_key(&d3,key);
+		f.d3 = &d3;
+	} else {
+		des_key(&dc,key);
+		f.dc = &dc;
+	}
+
+	f.pool = pool;
+	f.encrypt = (action == ACT_ENC);
+	f.chain = chain;
+	f.pad = padding;
+	pack_key(hexiv,f.iv);
+
+	if (usemmap)
+		return(do_file_mmap(&f));
+
+	in = 0;
+	if (infile != NULL && strcmp(infile,"-") != 0)
+		in = open(infile,O_RDONLY);
+	if (in < 0)
+	{
+		perror(infile);
+		return(1);
+	}
+
+	/* Streaming can't overwrite its own input; never truncate it */
+	if (outfile != NULL && strcmp(outfile,"-") != 0 &&
+	    fstat(in,&ist) == 0 && S_ISREG(ist.st_mode) &&
+	    stat(outfile,&ost) == 0 &&
+	    ost.st_dev == ist.st_dev && ost.st_ino == ist.st_ino)
+	{
+		fprintf(stderr,"%s: output is the input file, use --mmap to crypt in place!\n",outfile);
+		if (in != 0)
+			close(in);
+		return(1);
+	}
+
+	out = 1;
+	if (outfile != NULL && strcmp(outfile,"-") != 0)
+		out = open(outfile,O_WRONLY | O_CREAT | O_TRUNC,0644);
+	if (out < 0)
+	{
+		perror(outfile);
+		if (in != 0)
+			close(in);
+		return(1);
+	}
+
+	if (async >= 0)
+		err = des_file_async(&f,in,out,depth,async);
 	else
-		show_key("",cp);
+		err = des_file_crypt(&f,in,out);
+	if (err != 0)
+		fprintf(stderr,"%s: %s\n",infile != NULL ? infile : "stdin",des_file_error(err));
+
+	if (in != 0)
+		close(in);
+	if (out != 1 && close(out) != 0 && err == 0)
+	{
+		perror(outfile);
+		return(1);
+	}
+
+	return(err != 0);
+}
+
+/* Function to do the --mmap variant of do_file(). The input must
+ * be a regular file. No --out, or an --out that is the input file
+ * under any name, means in place. Returns the exit status.
+ */
+int do_file_mmap(des_file * f)
+{
+	struct stat ist, ost;
+	int in, out, err, same;
+
+	if (infile == NULL || strcmp(infile,"-") == 0)
+	{
+		fprintf(stderr,"--mmap needs an --in file!\n");
+		return(1);
+	}
+	if (outfile != NULL && strcmp(outfile,"-") == 0)
+	{
+		fprintf(stderr,"--mmap can't write to stdout!\n");
+		return(1);
+	}
+
+	in = open(infile,O_RDONLY);
+	if (in < 0 || fstat(in,&ist) != 0)
+	{
+		perror(infile);
+		if (in >= 0)
+			close(in);
+		return(1);
+	}
+
+	/* Compare files, not names, before anything is truncated */
+	out = -1;
+	if (outfile != NULL)
+	{
+		same = 0;
+		if (stat(outfile,&ost) == 0)
+			same = ost.st_dev == ist.st_dev && ost.st_ino == ist.st_ino;
+		else if (errno != ENOENT)
+		{
+			perror(outfile);
+			close(in);
+			return(1);
+		}
+		if (!same)
+		{
+			out = open(outfile,O_RDWR | O_CREAT | O_TRUNC,0644);
+			if (out < 0)
+			{
+				perror(outfile);
+				close(in);
+				return(1);
+			}
+		}
+	}
+
+	/* In place needs the input writable */
+	if (out < 0)
+	{
+		close(in);
+		in = open(infile,O_RDWR);
+		if (in < 0)
+		{
+			perror(infile);
+			return(1);
+		}
+	}
+
+	err = des_file_mmap(f,in,out);
+	if (err != 0)
+		fprintf(stderr,"%s: %s\n",infile,des_file_error(err));
+
+	close(in);
+	if (out >= 0)
+		close(out);
+
+	return(err != 0);
+}
+
+/* Function to run a whole list of key/data pairs in one process.
+ * Each line of the file (stdin for NULL or "-") is "<KEY> <DATA>",
+ * the key sized for the mode and the data one or more 16 digit
+ * blocks, done with the current action and chaining (each line
+ * starting from --iv). Every line gives exactly one line of output,
+ * in order: the result in hex, or "ERROR <reason>". The line, data
+ * and output buffers are reused, growing only for a longer line.
+ * Returns the exit status, 1 if any line failed.
+ */
+int do_batch(char * name)
+{
+	FILE *in;
+	des_ctx dc;
+	des3_ctx d3;
+	des_file f;
+	des_cache *cache = NULL;
+	des_cache_stats st;
+	unsigned char key[CBLOCK_SIZE * 3];
+	char *line = NULL, *out = NULL, *hexk, *hexd, *end, *err;
+	unsigned char *data = NULL, *ndata;
+	char *nout;
+	size_t linecap = 0, cap = 0, klen, dlen;
+	ssize_t len;
+	int bad = 0;
+
+	in = stdin;
+	if (name != NULL && strcmp(name,"-") != 0)
+		in = fopen(name,"r");
+	if (in == NULL)
+	{
+		perror(name);
+		return(1);
+	}
+	setvbuf(in,NULL,_IOFBF,DES_FILE_BUF);
+	setvbuf(stdout,NULL,_IOFBF,DES_FILE_BUF);
+
+	memset(&f,0x00,sizeof(f));
+	f.pool = pool;
+	f.encrypt = (action == ACT_ENC);
+	f.chain = chain;
+
+	/* Repeated keys skip the key schedule entirely */
+	if (cachesize > 0)
+		cache = des_cache_create(cachesize);
+
+	for (;;)
+	{
+		DES_PROF_START(tio);
+		len = getline(&line,&linecap,in);
+		DES_PROF_END(DES_PROF_IO,tio);
+		if (len < 0)
+			break;
+
+		/* Split "<KEY> <DATA>", ignoring surrounding blanks */
+		hexk = line + strspn(line," \t");
+		klen = strcspn(hexk," \t\r\n");
+		hexd = hexk + klen + strspn(hexk + klen," \t");
+		dlen = strcspn(hexd," \t\r\n");
+		end = hexd + dlen + strspn(hexd + dlen," \t\r\n");
+
+		/* Grow the buffers for the longest line so far */
+		if (cap < dlen / 2)
+		{
+			ndata = realloc(data,dlen / 2);
+			if (ndata != NULL)
+				data = ndata;
+			nout = realloc(out,dlen + 2);
+			if (nout != NULL)
+				out = nout;
+			if (ndata == NULL || nout == NULL)
+			{
+				fprintf(stderr,"out of memory!\n");
+				des_cache_destroy(cache);
+				if (in != stdin)
+					fclose(in);
+				free(line);
+				free(data);
+				free(out);
+				return(1);
+			}
+			cap = dlen / 2;
+		}
+
+		/* Unpack and check the hex as we go */
+		DES_PROF_START(tparse);
+		err = NULL;
+		if (!checkKeySize(mode,(int)klen))
+			err = "hexkey size not correct for mode";
+		else if (des_hex_decode(hexk,key,klen / 2) != 0)
+			err = "hexkey not hex";
+		else if (dlen == 0 || dlen % HEXBLOCK_SIZE != 0)
+			err = "hexdata size not a multiple of 16";
+		else if (des_hex_decode(hexd,data,dlen / 2) != 0)
+			err = "hexdata not hex";
+		else if (*end != 0)
+			err = "extra fields";
+		DES_PROF_END(DES_PROF_PARSE,tparse);
+		if (err != NULL)
+		{
+			printf("ERROR %s\n",err);
+			bad = 1;
+			continue;
+		}
 
+		/* Setup key structure */
+		if (mode == MODE_TDES)
+		{
+			if (cache != NULL)
+				f.d3 = des3_cache_key(cache,key,(int)klen / 2);
+			else {
+				if (klen == HEXBLOCK_SIZE * 3)
+					des3_key3(&d3,key);
+				else
+					des3_key(&d3,key);
+				f.d3 = &d3;
+			}
+		} else {
+			if (cache != NULL)
+				f.dc = des_cache_key(cache,key);
+			else {
+				des_key(&dc,key);
+				f.dc = &dc;
+			}
+		}
+
+		pack_key(hexiv,f.iv);
+		des_file_buf(&f,data,dlen / 2);
+
+		DES_PROF_START(tout);
+		des_hex_encode(data,out,dlen / 2);
+		out[dlen] = '\n';
+		fwrite(out,1,dlen + 1,stdout);
+		DES_PROF_END(DES_PROF_OUTPUT,tout);
+	}
+
+	if (ferror(in))
+	{
+		perror(name != NULL ? name : "stdin");
+		bad = 1;
+	}
+	if (in != stdin)
+		fclose(in);
+	fflush(stdout);
+	if (stats && cache != NULL)
+	{
+		des_cache_get_stats(cache,&st);
+		fprintf(stderr,"key cache: %lu hits, %lu misses, %lu evictions, %d/%d entries",
+			st.hits,st.misses,st.evictions,st.entries,st.size);
+		if (st.hits + st.misses > 0)
+			fprintf(stderr," (%.1f%% hit rate)",
+				100.0 * st.hits / (st.hits + st.misses));
+		fprintf(stderr,"\n");
+	} else if (stats)
+		fprintf(stderr,"key cache: off\n");
+	des_cache_destroy(cache);
+	free(line);
+	free(data);
+	free(out);
+	return(bad);
 }
 
 /* This function will print the program header
@@ -627,11 +1126,43 @@ void usage(char * name)
 	printf("	--sdes             Sets Single DES mode. (default)\n");
 	printf("	-h --help          Prints this help and exits.\n");
 	printf("	-v --version       Prints version and exits.\n");
-	printf("	-k --key <KEY>     Specifies Key to be used.\n");
-	printf("	-d --data <DATA>   Specifies Data Block.\n");
-	printf("	-b --block <DATA>  Specifies Data Block.\n");
+	printf("	-k --key <KEY>     Specifies Key to be used, 16 hex digits for SDES,\n");
+	printf("	                   32 (K1,K2) or 48 (K1,K2,K3) for TDES.\n");
+	printf("	-d --data <DATA>   Specifies Data Block(s), 16 hex digits each.\n");
+	printf("	-b --block <DATA>  Specifies Data Block(s), 16 hex digits each.\n");
 	printf("	-m --mode {0|1}    Sets DES Mode, 0 - SDES, 1 - TDES.\n");
 	printf("	-a --action {0|1}  Sets Crypt Action, 0 - DECRYPT, 1 - ENCRYPT.\n");
+	printf("	--kernel <NAME>    Selects DES kernel: auto, avx512, avx2, sse2,\n");
+	printf("	                   scalar or table. 'list' shows them. (default auto)\n");
+	printf("	--threads <N>      Worker threads for bulk data, 0 - one per CPU. (default 1)\n");
+	printf("	--ecb              Does multi-block data in ECB. (default)\n");
+	printf("	--cbc              Does multi-block data in CBC.\n");
+	printf("	--ctr              Does multi-block data in CTR.\n");
+	printf("	--iv <IV>          Specifies the CBC IV or first CTR counter block,\n");
+	printf("	                   16 hex digits. (default 0)\n");
+	printf("	--in <FILE>        Crypts FILE instead of --data, '-' for stdin.\n");
+	printf("	--out <FILE>       Writes the result to FILE, '-' for stdout. (default)\n");
+	printf("	--pad <PAD>        File padding for ECB and CBC: pkcs5, iso or none.\n");
+	printf("	                   (default pkcs5)\n");
+	printf("	--mmap             Memory maps the --in file; with no --out (or\n");
+	printf("	                   --out the same file) it is crypted in place.\n");
+	printf("	--async[=ENGINE]   Overlaps file I/O and crypting: auto, uring or\n");
+	printf("	                   threads. (default auto)\n");
+	printf("	--depth <N>        Buffers in flight with --async. (default %d)\n",DES_FILE_DEPTH);
+	printf("	--batch[=FILE]     Reads '<KEY> <DATA>' lines from FILE (default stdin)\n");
+	printf("	                   and writes one result line for each.\n");
+	printf("	--serve <PATH>     Serves binary requests (see desserve.h) on the Unix\n");
+	printf("	                   socket PATH until interrupted.\n");
+	printf("	--cache <N>        Key schedules kept by --batch and --serve, 0 - none.\n");
+	printf("	                   (default %d)\n",DES_CACHE_SIZE);
+	printf("	--stats            Prints key cache hits and misses to stderr.\n");
+	printf("	--bench            Runs the benchmarks: key setup, block latency, bulk\n");
+	printf("	                   ECB/CBC/CTR and thread scaling up to --threads\n");
+	printf("	                   (or one per CPU), then exits.\n");
+	printf("	--json             Prints --bench results as JSON.\n");
+	printf("	--reps <N>         Repetitions per benchmark case. (default 11)\n");
+	printf("	--kat              Runs the known answer, Monte Carlo and kernel\n");
+	printf("	                   cross checks, then exits 0 if all pass.\n");
 	printf("\n");
 }
 
@@ -651,8 +1182,10 @@ int main(int argc, char * argv[]) {
 	int gotblock = 0;
 	unsigned char hexkey1[HEXKEY_SIZE];
 	unsigned char hexkey2[HEXKEY_SIZE];
-	unsigned char hexdata[HEXKEY_SIZE];
-	unsigned char hexkey[33];
+	unsigned char * hexdata;
+	unsigned char hexkey[HEXBLOCK_SIZE * 3 + 1];
+
+	DES_PROF_INIT();
 
 	if (verbose)
 		header();
@@ -670,8 +1203,7 @@ int main(int argc, char * argv[]) {
 	if (debug)
 		printf("%s: '%s'\n","hexkey2",hexkey2);
 
-	memset(hexdata,0x00,sizeof(hexdata));
-	strcpy(hexdata,"0000000000000000");
+	hexdata = "0000000000000000";
 
 	int c;
 
@@ -691,6 +1223,14 @@ int main(int argc, char * argv[]) {
 			{"notests",   no_argument,       &tests, 0},
 			{"tdes",      no_argument,        &mode, 1},
 			{"sdes",      no_argument,        &mode, 0},
+			{"ecb",       no_argument,       &chain, DES_ECB},
+			{"cbc",       no_argument,       &chain, DES_CBC},
+			{"ctr",       no_argument,       &chain, DES_CTR},
+			{"mmap",      no_argument,     &usemmap, 1},
+			{"stats",     no_argument,       &stats, 1},
+			{"bench",     no_argument,       &bench, 1},
+			{"json",      no_argument,        &json, 1},
+			{"kat",       no_argument,         &kat, 1},
 			/* These options dont set a flag.
 			   We distinguish them by their indices. */
 			{"help",      no_argument,           0, 'h'},
@@ -700,6 +1240,18 @@ int main(int argc, char * argv[]) {
 			{"block",    required_argument,      0, 'b'},
 			{"mode",     required_argument,      0, 'm'},
 			{"action",   required_argument,      0, 'a'},
+			{"kernel",   required_argument,      0, 'K'},
+			{"threads",  required_argument,      0, 'T'},
+			{"iv",       required_argument,      0, 'I'},
+			{"in",       required_argument,      0, 'i'},
+			{"out",      required_argument,      0, 'o'},
+			{"pad",      required_argument,      0, 'P'},
+			{"async",    optional_argument,      0, 'A'},
+			{"depth",    required_argument,      0, 'D'},
+			{"batch",    optional_argument,      0, 'B'},
+			{"cache",    required_argument,      0, 'C'},
+			{"serve",    required_argument,      0, 'S'},
+			{"reps",     required_argument,      0, 'R'},
 			{0, 0, 0, 0}
 		};
 		/* getopt_long stores the option index here. */
@@ -742,6 +1294,11 @@ int main(int argc, char * argv[]) {
 			case 'k':
 				if (debug)
 					printf("option '-k' -or- '--key' with value: '%s'\n",optarg);
+				if (strlen(optarg) >= sizeof(hexkey))
+				{
+					printf("hexkey size not correct for mode!\n");
+					exit(1);
+				}
 				strcpy(hexkey,optarg);
 				gotkey = 1;
 				break;
@@ -750,7 +1307,13 @@ int main(int argc, char * argv[]) {
 			case 'b':
 				if (debug)
 					printf("option '-d','-b','--data', or '--block' with value: '%s'\n",optarg);
-				strcpy(hexdata,optarg);
+				/* Whole blocks only; --tests reads the first 16 digits */
+				if (strlen(optarg) == 0 || strlen(optarg) % HEXBLOCK_SIZE != 0)
+				{
+					printf("hexdata size not a multiple of %d!\n",HEXBLOCK_SIZE);
+					exit(1);
+				}
+				hexdata = optarg;
 				gotblock = 1;
 				break;
 
@@ -776,6 +1339,118 @@ int main(int argc, char * argv[]) {
 						printf("Action set to 'Encrypt'!\n");
 				break;
 
+			case 'K':
+				if (debug)
+					printf("option '--kernel' with value: '%s'\n",optarg);
+				if (strcmp(optarg,"list") == 0)
+				{
+					des_show_kernels();
+					exit(0);
+				}
+				if (des_set_kernel(optarg) != 0)
+				{
+					printf("Unknown or unsupported kernel '%s'!\n",optarg);
+					des_show_kernels();
+					exit(1);
+				}
+				if (verbose)
+					printf("Kernel set to '%s'!\n",des_kernel_name());
+				break;
+
+			case 'T':
+				if (debug)
+					printf("option '--threads' with value: '%s'\n",optarg);
+				threads = atoi(optarg);
+				if (verbose)
+					printf("Threads set to %d!\n",threads);
+				break;
+
+			case 'I':
+				if (debug)
+					printf("option '--iv' with value: '%s'\n",optarg);
+				if (strlen(optarg) != HEXBLOCK_SIZE)
+				{
+					printf("IV must be %d hex digits!\n",HEXBLOCK_SIZE);
+					exit(1);
+				}
+				hexiv = optarg;
+				break;
+
+			case 'i':
+				if (debug)
+					printf("option '--in' with value: '%s'\n",optarg);
+				infile = optarg;
+				break;
+
+			case 'o':
+				if (debug)
+					printf("option '--out' with value: '%s'\n",optarg);
+				outfile = optarg;
+				break;
+
+			case 'P':
+				if (debug)
+					printf("option '--pad' with value: '%s'\n",optarg);
+				if (strcmp(optarg,"none") == 0)
+					padding = DES_PAD_NONE;
+				else if (strcmp(optarg,"pkcs5") == 0 || strcmp(optarg,"pkcs7") == 0)
+					padding = DES_PAD_PKCS5;
+				else if (strcmp(optarg,"iso") == 0)
+					padding = DES_PAD_ISO;
+				else
+				{
+					printf("Unknown padding '%s'!\n",optarg);
+					exit(1);
+				}
+				break;
+
+			case 'A':
+				if (debug)
+					printf("option '--async' with value: '%s'\n",optarg ? optarg : "");
+				if (optarg == NULL || strcmp(optarg,"auto") == 0)
+					async = DES_AIO_AUTO;
+				else if (strcmp(optarg,"uring") == 0)
+					async = DES_AIO_URING;
+				else if (strcmp(optarg,"threads") == 0)
+					async = DES_AIO_THREADS;
+				else
+				{
+					printf("Unknown async engine '%s'!\n",optarg);
+					exit(1);
+				}
+				break;
+
+			case 'D':
+				if (debug)
+					printf("option '--depth' with value: '%s'\n",optarg);
+				depth = atoi(optarg);
+				break;
+
+			case 'B':
+				if (debug)
+					printf("option '--batch' with value: '%s'\n",optarg ? optarg : "");
+				batch = 1;
+				batchfile = optarg;
+				break;
+
+			case 'C':
+				if (debug)
+					printf("option '--cache' with value: '%s'\n",optarg);
+				cachesize = atoi(optarg);
+				break;
+
+			case 'S':
+				if (debug)
+					printf("option '--serve' with value: '%s'\n",optarg);
+				servepath = optarg;
+				break;
+
+			case 'R':
+				if (debug)
+					printf("option '--reps' with value: '%s'\n",optarg);
+				reps = atoi(optarg);
+				break;
+
 			case '?':
 				/* getopt_long already printed an error message. */
 				break;
@@ -866,6 +1541,38 @@ int main(int argc, char * argv[]) {
 		printf("%s: '%s'\n","hexkey2",hexkey2);
 	}
 
+	if (bench)
+		exit(do_bench(json,reps,threads < 0 ? 0 : threads));
+
+	if (kat)
+		exit(do_kat());
+
+	if (threads < 0)
+		threads = 1;
+	if (threads != 1)
+		pool = des_pool_create(threads);
+
+	if (servepath != NULL)
+	{
+		i = des_serve(servepath,pool,cachesize,stats);
+		des_pool_destroy(pool);
+		exit(i);
+	}
+
+	if (batch)
+	{
+		i = do_batch(batchfile);
+		des_pool_destroy(pool);
+		exit(i);
+	}
+
+	if (infile != NULL || outfile != NULL)
+	{
+		i = do_file(hexkey);
+		des_pool_destroy(pool);
+		exit(i);
+	}
+
 	if (mode == MODE_SDES)
 	{
 		if (action == ACT_ENC)
@@ -879,6 +1586,7 @@ int main(int argc, char * argv[]) {
 			do_tdes_dec(hexdata,hexkey);
 	}
 
+	des_pool_destroy(pool);
 	exit(0);
 }
 
@@ -10,13 +10,21 @@
 #ifndef __TESTDES_H__
 #define __TESTDES_H__
 
+#include "desfile.h"
+#include "descache.h"
+
 #define VER_MAJOR 1
 #define VER_MINOR 1
 
 // Global Prototypes
 
 int getKeySize(int tmode);
+int checkKeySize(int tmode, int size);
 void show_key(char * name, unsigned char * key);
+void show_data(char * name, unsigned char * data, int blocks);
+int pack_data(unsigned char * hexdata, unsigned char ** data);
+void pack_key(unsigned char * key, unsigned char * deskey);
+void pack_key_legacy(unsigned char * key, unsigned char * deskey);
 
 void do_sdes_tests(unsigned char * hexdata, unsigned char * hexkey);
 void do_tdes_tests(unsigned char * hexdata, unsigned char * hexkey);
@@ -25,6 +33,11 @@ void do_sdes_dec(unsigned char * hexdata, unsigned char * hexkey);
 void do_sdes_enc(unsigned char * hexdata, unsigned char * hexkey);
 void do_tdes_dec(unsigned char * hexdata, unsigned char * hexkey);
 void do_tdes_enc(unsigned char * hexdata, unsigned char * hexkey);
+int do_file(unsigned char * hexkey);
+int do_file_mmap(des_file * f);
+int do_batch(char * name);
+int do_bench(int json, int reps, int maxthreads);
+int do_kat(void);
 void header(void);
 void version(void);
 void usage(char * name);
@@ -0,0 +1,159 @@
+/*
+ * testhex.c - Hex key helpers for the DES Test Program
+ *
+ * pack_key() turns a 16 digit hex string into a cblock. It is private
+ * to testdes (and desbench, which times it); library users have
+ * des_hex_decode(), which takes a length and reports bad digits.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#include "testdes.h"
+#include "desutils.h"
+#include "deshex.h"
+#include "desprof.h"
+
+/* This function will convert a single digit ASCII character
+ * (typed as int) representing a hex string digit into the
+ * integer value it represents. E.g. 'F' returns (int)15
+ */
+static int hex2int(int num)
+{
+	int n = 0;
+
+	//printf("num: %d\n",num);
+	switch (num) {
+
+		case '0':	// 48
+			n = 0;
+			break;
+
+		case '1':	// 49
+			n = 1;
+			break;
+
+		case '2':	// 50
+			n = 2;
+			break;
+
+		case '3':	// 51
+			n = 3;
+			break;
+
+		case '4':	// 52
+			n = 4;
+			break;
+
+		case '5':	// 53
+			n = 5;
+			break;
+
+		case '6':	// 54
+			n = 6;
+			break;
+
+		case '7':	// 55
+			n = 7;
+			break;
+
+		case '8':	// 56
+			n = 8;
+			break;
+
+		case '9':	// 57
+			n = 9;
+			break;
+
+		case 'A':	// 65
+			n = 10;
+			break;
+
+		case 'B':	// 66
+			n = 11;
+			break;
+
+		case 'C':	// 67
+			n = 12;
+			break;
+
+		case 'D':	// 68
+			n = 13;
+			break;
+
+		case 'E':	// 69
+			n = 14;
+			break;
+
+		case 'F':	// 70
+			n = 15;
+			break;
+
+		case 'a':	// 97
+			n = 10;
+			break;
+
+		case 'b':	// 98
+			n = 11;
+			break;
+
+		case 'c':	// 99
+			n = 12;
+			break;
+
+		case 'd':	// 100
+			n = 13;
+			break;
+
+		case 'e':	// 101
+			n = 14;
+			break;
+
+		case 'f':	// 102
+			n = 15;
+			break;
+	}
+
+	return (n);
+}
+
+/* This function will pack an ASCII HEX string into a hex
+ * array (which is really a cblock), one digit at a time
+ * through hex2int(). Anything that is not a hex digit packs
+ * as 0.
+ */
+void pack_key_legacy(unsigned char * key, unsigned char * deskey)
+{
+   	unsigned int hexint1 = 0;
+   	unsigned int hexint2 = 0;
+   	unsigned int j = 0;
+   	unsigned int c = 0;
+   	int i;
+	unsigned char *tmpkey;
+
+	tmpkey = deskey;
+
+   	/* Pack ASCII KEY string into hex array */
+   	j = 0;
+   	for(i=0; i<HEXBLOCK_SIZE; i+=2) {
+		hexint1 = hex2int(key[i]);
+		hexint2 = hex2int(key[i+1]);
+		c = ((hexint1 * 16 ) + hexint2) & 0xFF;
+		//printf("[i: %x 1: 0x%02x 2: 0x%02x c: 0x%02x]\n",i,hexint1,hexint2,c);
+		tmpkey[j] = c;
+	        j++;
+   	}
+}
+
+/* This function will pack an ASCII HEX string into a hex
+ * array (which is really a cblock). Anything that is not a
+ * hex digit packs as 0; use des_hex_decode() to catch those.
+ */
+void pack_key(unsigned char * key, unsigned char * deskey)
+{
+	DES_PROF_START(t);
+
+	if (des_hex_decode((const char *)key,deskey,CBLOCK_SIZE) != 0)
+		pack_key_legacy(key,deskey);
+	DES_PROF_END(DES_PROF_PARSE,t);
+}
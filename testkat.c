@@ -0,0 +1,698 @@
+/*
+ * testkat.c - Known answer and cross checks for the DES Test Program
+ *
+ * do_kat() runs:
+ *   - the NIST SP 800-20 DES tables (variable plaintext and its inverse,
+ *     variable key, permutation operation and substitution table), the
+ *     SP 800-67 Triple DES example and a few classic vectors;
+ *   - Monte Carlo tests of 400 x 10000 chained ECB operations for DES,
+ *     two-key and three-key Triple DES, each way;
+ *   - every bulk kernel this CPU supports, and every mode (ECB, CBC,
+ *     CTR, multi-stream CBC, multi-key ECB and the thread pool), against
+ *     one block at a time through des_r() on random keys and data;
+ *   - every hex codec against a plain table lookup.
+ *
+ * The Monte Carlo procedure follows the NIST TMOVS ECB test: after
+ * each 10000 operations K1 ^= C[9999], K2 ^= C[9998], K3 ^= C[9997]
+ * (two-key TDES keeps K3 = K1). Its expected results were computed
+ * with an independent implementation.
+ *
+ * (C) 2015 KB4OID Labs, A Division of Kodetroll Heavy Industries
+ * Author: Kodetroll
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testdes.h"
+#include "desutils.h"
+#include "despool.h"
+#include "deshex.h"
+
+#define KAT_MCT_OUTER	400
+#define KAT_MCT_INNER	10000
+#define KAT_MAXBLOCKS	6157	/* Largest random buffer, in blocks */
+#define KAT_SHOW	5	/* Mismatches printed per check */
+#define KAT_STREAMS	37	/* Buffers per multi-key ECB check */
+
+/* SP 800-20 Table 1: key 0101010101010101, plaintext bit i set (MSB
+   first). Decrypting these is the inverse permutation test. */
+static const char *kat_vp[64] = {
+	"95F8A5E5DD31D900", "DD7F121CA5015619", "2E8653104F3834EA", "4BD388FF6CD81D4F",
+	"20B9E767B2FB1456", "55579380D77138EF", "6CC5DEFAAF04512F", "0D9F279BA5D87260",
+	"D9031B0271BD5A0A", "424250B37C3DD951", "B8061B7ECD9A21E5", "F15D0F286B65BD28",
+	"ADD0CC8D6E5DEBA1", "E6D5F82752AD63D1", "ECBFE3BD3F591A5E", "F356834379D165CD",
+	"2B9F982F20037FA9", "889DE068A16F0BE6", "E19E275D846A1298", "329A8ED523D71AEC",
+	"E7FCE22557D23C97", "12A9F5817FF2D65D", "A484C3AD38DC9C19", "FBE00A8A1EF8AD72",
+	"750D079407521363", "64FEED9C724C2FAF", "F02B263B328E2B60", "9D64555A9A10B852",
+	"D106FF0BED5255D7", "E1652C6B138C64A5", "E428581186EC8F46", "AEB5F5EDE22D1A36",
+	"E943D7568AEC0C5C", "DF98C8276F54B04B", "B160E4680F6C696F", "FA0752B07D9C4AB8",
+	"CA3A2B036DBC8502", "5E0905517BB59BCF", "814EEB3B91D90726", "4D49DB1532919C9F",
+	"25EB5FC3F8CF0621", "AB6A20C0620D1C6F", "79E90DBC98F92CCA", "866ECEDD8072BB0E",
+	"8B54536F2F3E64A8", "EA51D3975595B86B", "CAFFC6AC4542DE31", "8DD45A2DDF90796C",
+	"1029D55E880EC2D0", "5D86CB23639DBEA9", "1D1CA853AE7C0C5F", "CE332329248F3228",
+	"8405D1ABE24FB942", "E643D78090CA4207", "48221B9937748A23", "DD7C0BBD61FAFD54",
+	"2FBC291A570DB5C4", "E07C30D7E4E26E12", "0953E2258E8E90A1", "5B711BC4CEEBF2EE",
+	"CC083F1E6D9E85F6", "D2FD8867D50D2DFE", "06E7EA22CE92708F", "166B40B44ABA4BD6" };
+
+/* SP 800-20 Table 2: key bit i set, skipping parity bits, plaintext 0 */
+static const char *kat_vk[56] = {
+	"95A8D72813DAA94D", "0EEC1487DD8C26D5", "7AD16FFB79C45926", "D3746294CA6A6CF3",
+	"809F5F873C1FD761", "C02FAFFEC989D1FC", "4615AA1D33E72F10", "2055123350C00858",
+	"DF3B99D6577397C8", "31FE17369B5288C9", "DFDD3CC64DAE1642", "178C83CE2B399D94",
+	"50F636324A9B7F80", "A8468EE3BC18F06D", "A2DC9E92FD3CDE92", "CAC09F797D031287",
+	"90BA680B22AEB525", "CE7A24F350E280B6", "882BFF0AA01A0B87", "25610288924511C2",
+	"C71516C29C75D170", "5199C29A52C9F059", "C22F0A294A71F29F", "EE371483714C02EA",
+	"A81FBD448F9E522F", "4F644C92E192DFED", "1AFA9A66A6DF92AE", "B3C1CC715CB879D8",
+	"19D032E64AB0BD8B", "3CFAA7A7DC8720DC", "B7265F7F447AC6F3", "9DB73B3C0D163F54",
+	"8181B65BABF4A975", "93C9B64042EAA240", "5570530829705592", "8638809E878787A0",
+	"41B9A79AF79AC208", "7A9BE42F2009A892", "29038D56BA6D2745", "5495C6ABF1E5DF51",
+	"AE13DBD561488933", "024D1FFA8904E389", "D1399712F99BF02E", "14C1D7C1CFFEC79E",
+	"1DE5279DAE3BED6F", "E941A33F85501303", "DA99DBBC9A03F379", "B7FC92F91D8E92E9",
+	"AE8E5CAA3CA04E85", "9CC62DF43B6EED74", "D863DBB5C59A91A0", "A1AB2190545B91D7",
+	"0875041E64C570F7", "5A594528BEBEF1CC", "FCDB3291DE21F0C0", "869EFD7F9F265A09" };
+
+/* SP 800-20 Table 3: permutation operation, plaintext 0 */
+static const char *kat_perm[32][2] = {
+	{ "1046913489980131", "88D55E54F54C97B4" },
+	{ "1007103489988020", "0C0CC00C83EA48FD" },
+	{ "10071034C8980120", "83BC8EF3A6570183" },
+	{ "1046103489988020", "DF725DCAD94EA2E9" },
+	{ "1086911519190101", "E652B53B550BE8B0" },
+	{ "1086911519580101", "AF527120C485CBB0" },
+	{ "5107B01519580101", "0F04CE393DB926D5" },
+	{ "1007B01519190101", "C9F00FFC74079067" },
+	{ "3107915498080101", "7CFD82A593252B4E" },
+	{ "3107919498080101", "CB49A2F9E91363E3" },
+	{ "10079115B9080140", "00B588BE70D23F56" },
+	{ "3107911598080140", "406A9A6AB43399AE" },
+	{ "1007D01589980101", "6CB773611DCA9ADA" },
+	{ "9107911589980101", "67FD21C17DBB5D70" },
+	{ "9107D01589190101", "9592CB4110430787" },
+	{ "1007D01598980120", "A6B7FF68A318DDD3" },
+	{ "1007940498190101", "4D102196C914CA16" },
+	{ "0107910491190401", "2DFA9F4573594965" },
+	{ "0107910491190101", "B46604816C0E0774" },
+	{ "0107940491190401", "6E7E6221A4F34E87" },
+	{ "19079210981A0101", "AA85E74643233199" },
+	{ "1007911998190801", "2E5A19DB4D1962D6" },
+	{ "10079119981A0801", "23A866A809D30894" },
+	{ "1007921098190101", "D812D961F017D320" },
+	{ "100791159819010B", "055605816E58608F" },
+	{ "1004801598190101", "ABD88E8B1B7716F1" },
+	{ "1004801598190102", "537AC95BE69DA1E1" },
+	{ "1004801598190108", "AED0F6AE3C25CDD8" },
+	{ "1002911498100104", "B3E35A5EE53E7B8D" },
+	{ "1002911598190104", "61C79C71921A2EF8" },
+	{ "1002911598100201", "E2F5728F0995013C" },
+	{ "1002911698100101", "1AEAC39A61F0A464" } };
+
+/* SP 800-20 Table 4: substitution table */
+static const char *kat_sub[19][3] = {
+	{ "7CA110454A1A6E57", "01A1D6D039776742", "690F5B0D9A26939B" },
+	{ "0131D9619DC1376E", "5CD54CA83DEF57DA", "7A389D10354BD271" },
+	{ "07A1133E4A0B2686", "0248D43806F67172", "868EBB51CAB4599A" },
+	{ "3849674C2602319E", "51454B582DDF440A", "7178876E01F19B2A" },
+	{ "04B915BA43FEB5B6", "42FD443059577FA2", "AF37FB421F8C4095" },
+	{ "0113B970FD34F2CE", "059B5E0851CF143A", "86A560F10EC6D85B" },
+	{ "0170F175468FB5E6", "0756D8E0774761D2", "0CD3DA020021DC09" },
+	{ "43297FAD38E373FE", "762514B829BF486A", "EA676B2CB7DB2B7A" },
+	{ "07A7137045DA2A16", "3BDD119049372802", "DFD64A815CAF1A0F" },
+	{ "04689104C2FD3B2F", "26955F6835AF609A", "5C513C9C4886C088" },
+	{ "37D06BB516CB7546", "164D5E404F275232", "0A2AEEAE3FF4AB77" },
+	{ "1F08260D1AC2465E", "6B056E18759F5CCA", "EF1BF03E5DFA575A" },
+	{ "584023641ABA6176", "004BD6EF09176062", "88BF0DB6D70DEE56" },
+	{ "025816164629B007", "480D39006EE762F2", "A1F9915541020B56" },
+	{ "49793EBC79B3258F", "437540C8698F3CFA", "6FBF1CAFCFFD0556" },
+	{ "4FB05E1515AB73A7", "072D43A077075292", "2F22E49BAB7CA1AC" },
+	{ "49E95D6D4CA229BF", "02FE55778117F12A", "5A6B612CC26CCE4A" },
+	{ "018310DC409B26D6", "1D9D5C5018F728C2", "5F4C038ED12B2E41" },
+	{ "1C587F1C13924FEF", "305532286D6F295A", "63FAC0D034D9F793" } };
+
+/* Other published vectors: key, plaintext, ciphertext */
+static const char *kat_misc[][3] = {
+	{ "0123456789ABCDEF", "0123456789ABCDE7", "C95744256A5ED31D" },	/* desutils.c */
+	{ "0123456789ABCDEF", "4E6F772069732074", "3FA40E8A984D4815" },	/* "Now is t" */
+	{ "0123456789ABCDEF23456789ABCDEF01456789ABCDEF0123",		/* SP 800-67 */
+	  "5468652071756663", "A826FD8CE53B855F" },
+	{ NULL, NULL, NULL } };
+
+/* Monte Carlo: keys, 1 = encrypt, plaintext, result after 400 rounds */
+static const struct {
+	const char *name;
+	const char *key;
+	int encrypt;
+	const char *pt;
+	const char *ct;
+} kat_mct[] = {
+	{ "DES encrypt", "0123456789ABCDEF", 1, "4E6F772069732074", "74D8A695064EC574" },
+	{ "DES decrypt", "0123456789ABCDEF", 0, "4E6F772069732074", "E5777D545F9067F6" },
+	{ "TDES 2-key encrypt", "0123456789ABCDEF23456789ABCDEF01", 1,
+	  "5468652071756663", "E97A98E55A5C474A" },
+	{ "TDES 2-key decrypt", "0123456789ABCDEF23456789ABCDEF01", 0,
+	  "5468652071756663", "01A7BE406DF629E4" },
+	{ "TDES 3-key encrypt", "0123456789ABCDEF23456789ABCDEF01456789ABCDEF0123", 1,
+	  "5468652071756663", "9D33CA401F472DE8" },
+	{ "TDES 3-key decrypt", "0123456789ABCDEF23456789ABCDEF01456789ABCDEF0123", 0,
+	  "5468652071756663", "4542F7D6748217F3" },
+	{ NULL, NULL, 0, NULL, NULL } };
+
+/* Random buffer sizes in blocks: either side of every kernel's lane
+   count, and big enough for the pool to split across threads */
+static const int kat_sizes[] = { 1, 3, 4, 5, 63, 64, 65, 127, 129, 255, 257,
+	511, 512, 513, 1031, KAT_MAXBLOCKS };
+
+static const char *kat_kernels[] = { "avx512", "avx2", "sse2", "scalar", "table", NULL };
+static const char *kat_hexes[] = { "avx2", "ssse3", "scalar", NULL };
+
+static int kat_checks, kat_failed;
+static uint64_t kat_seed = 0x0123456789abcdefULL;
+
+static uint64_t kat_rand(void)
+{
+	/* xorshift64*, fixed seed so failures repeat */
+	kat_seed ^= kat_seed >> 12;
+	kat_seed ^= kat_seed << 25;
+	kat_seed ^= kat_seed >> 27;
+	return kat_seed * 0x2545f4914f6cdd1dULL;
+}
+
+static void kat_fill(unsigned char *p, long n)
+{
+	uint64_t r = 0;
+	long i;
+
+	for (i=0;i<n;i++)
+	{
+		if ((i & 7) == 0)
+			r = kat_rand();
+		p[i] = r >> ((i & 7) * 8);
+	}
+}
+
+static void kat_unhex(const char *hex, unsigned char *out)
+{
+	des_hex_decode(hex,out,strlen(hex) / 2);
+}
+
+/* Record one check; got and want are n bytes. what names the check */
+static int kat_cmp(const char *what, const unsigned char *got,
+		const unsigned char *want, long n)
+{
+	char hex[HEXBLOCK_SIZE + 1];
+	long i;
+
+	kat_checks++;
+	if (memcmp(got,want,n) == 0)
+		return(0);
+	if (kat_failed++ < KAT_SHOW)
+	{
+		for (i=0;i<n && got[i]==want[i];i++)
+			;
+		i &= ~7L;
+		printf("  MISMATCH %s at byte %ld:",what,i);
+		des_hex_encode(got + i,hex,CBLOCK_SIZE);
+		hex[HEXBLOCK_SIZE] = 0;
+		printf(" got %s",hex);
+		des_hex_encode(want + i,hex,CBLOCK_SIZE);
+		printf(" want %s\n",hex);
+	}
+	return(1);
+}
+
+static void kat_result(const char *group, int checks, int failed)
+{
+	printf("%-40s %6d %s\n",group,checks,failed ? "FAILED" : "ok");
+	fflush(stdout);
+}
+
+/* One vector: hexkey of 16, 32 or 48 digits, encrypt and decrypt */
+static void kat_vector(const char *what, const char *hexkey, const char *hexpt,
+		const char *hexct)
+{
+	des_ctx dc;
+	des3_ctx d3;
+	unsigned char key[24], pt[8], ct[8], b[8];
+	int len;
+
+	len = strlen(hexkey) / 2;
+	kat_unhex(hexkey,key);
+	kat_unhex(hexpt,pt);
+	kat_unhex(hexct,ct);
+	memcpy(b,pt,8);
+	if (len == 8)
+	{
+		des_key(&dc,key);
+		des_enc(&dc,b,1);
+		kat_cmp(what,b,ct,8);
+		des_dec(&dc,b,1);
+	} else {
+		if (len == 24)
+			des3_key3(&d3,key);
+		else
+			des3_key(&d3,key);
+		des3_enc(&d3,b,1);
+		kat_cmp(what,b,ct,8);
+		des3_dec(&d3,b,1);
+	}
+	kat_cmp(what,b,pt,8);
+}
+
+static void kat_tables(void)
+{
+	unsigned char key[8], pt[8];
+	char hexkey[HEXBLOCK_SIZE + 1], hexpt[HEXBLOCK_SIZE + 1];
+	int i, c, f;
+
+	hexkey[HEXBLOCK_SIZE] = hexpt[HEXBLOCK_SIZE] = 0;
+
+	c = kat_checks; f = kat_failed;
+	for (i=0;i<64;i++)
+	{
+		memset(pt,0x00,8);
+		pt[i / 8] = 0x80 >> (i % 8);
+		des_hex_encode(pt,hexpt,8);
+		kat_vector("variable plaintext","0101010101010101",hexpt,kat_vp[i]);
+	}
+	kat_result("SP 800-20 variable plaintext/inverse",kat_checks - c,kat_failed - f);
+
+	c = kat_checks; f = kat_failed;
+	for (i=0;i<64;i++)
+	{
+		if (i % 8 == 7)		/* parity bit */
+			continue;
+		memset(key,0x01,8);
+		key[i / 8] |= 0x80 >> (i % 8);
+		des_hex_encode(key,hexkey,8);
+		kat_vector("variable key",hexkey,"0000000000000000",kat_vk[i - i / 8]);
+	}
+	kat_result("SP 800-20 variable key",kat_checks - c,kat_failed - f);
+
+	c = kat_checks; f = kat_failed;
+	for (i=0;i<32;i++)
+		kat_vector("permutation",kat_perm[i][0],"0000000000000000",kat_perm[i][1]);
+	kat_result("SP 800-20 permutation operation",kat_checks - c,kat_failed - f);
+
+	c = kat_checks; f = kat_failed;
+	for (i=0;i<19;i++)
+		kat_vector("substitution",kat_sub[i][0],kat_sub[i][1],kat_sub[i][2]);
+	kat_result("SP 800-20 substitution table",kat_checks - c,kat_failed - f);
+
+	c = kat_checks; f = kat_failed;
+	for (i=0;kat_misc[i][0]!=NULL;i++)
+		kat_vector("vector",kat_misc[i][0],kat_misc[i][1],kat_misc[i][2]);
+	kat_result("SP 800-67 and other vectors",kat_checks - c,kat_failed - f);
+}
+
+static void kat_monte_carlo(void)
+{
+	des_ctx dc;
+	des3_ctx d3;
+	unsigned char key[24], b[8], c1[8], c2[8], want[8];
+	int t, i, j, k, len, c, f;
+
+	c = kat_checks; f = kat_failed;
+	for (t=0;kat_mct[t].name!=NULL;t++)
+	{
+		len = strlen(kat_mct[t].key) / 2;
+		kat_unhex(kat_mct[t].key,key);
+		kat_unhex(kat_mct[t].pt,b);
+		kat_unhex(kat_mct[t].ct,want);
+		for (i=0;i<KAT_MCT_OUTER;i++)
+		{
+			if (len == 8)
+				des_key(&dc,key);
+			else if (len == 16)
+				des3_key(&d3,key);
+			else
+				des3_key3(&d3,key);
+			for (j=0;j<KAT_MCT_INNER;j++)
+			{
+				memcpy(c2,c1,8);
+				memcpy(c1,b,8);
+				if (len == 8 && kat_mct[t].encrypt)
+					des_enc(&dc,b,1);
+				else if (len == 8)
+					des_dec(&dc,b,1);
+				else if (kat_mct[t].encrypt)
+					des3_enc(&d3,b,1);
+				else
+					des3_dec(&d3,b,1);
+			}
+			/* b is C[9999], c1 C[9998], c2 C[9997] */
+			for (k=0;k<8;k++)
+			{
+				key[k] ^= b[k];
+				if (len > 8)
+					key[8 + k] ^= c1[k];
+				if (len > 16)
+					key[16 + k] ^= c2[k];
+			}
+		}
+		kat_cmp(kat_mct[t].name,b,want,8);
+	}
+	kat_result("Monte Carlo (400 x 10000 ECB)",kat_checks - c,kat_failed - f);
+}
+
+/* Reference ECB, one block at a time through des_r() with up to three
+   schedules (ks[1] NULL for single DES) */
+static void ref_ecb(uint32_t *ks[3], unsigned char *p, long blocks)
+{
+	long i;
+
+	for (i=0;i<blocks;i++,p+=8)
+	{
+		des_r(ks[0],p,p);
+		if (ks[1] != NULL)
+		{
+			des_r(ks[1],p,p);
+			des_r(ks[2],p,p);
+		}
+	}
+}
+
+static void ref_cbc_enc(uint32_t *ks[3], unsigned char *iv, unsigned char *p, long blocks)
+{
+	unsigned char *prev = iv;
+	long i;
+	int j;
+
+	for (i=0;i<blocks;i++,p+=8)
+	{
+		for (j=0;j<8;j++)
+			p[j] ^= prev[j];
+		ref_ecb(ks,p,1);
+		prev = p;
+	}
+}
+
+static void ref_cbc_dec(uint32_t *ks[3], unsigned char *iv, unsigned char *p, long blocks)
+{
+	unsigned char prev[8], save[8];
+	long i;
+	int j;
+
+	memcpy(prev,iv,8);
+	for (i=0;i<blocks;i++,p+=8)
+	{
+		memcpy(save,p,8);
+		ref_ecb(ks,p,1);
+		for (j=0;j<8;j++)
+			p[j] ^= prev[j];
+		memcpy(prev,save,8);
+	}
+}
+
+static void ref_ctr(uint32_t *ks[3], unsigned char *ctr, unsigned char *p, long bytes)
+{
+	unsigned char c[8], k[8];
+	long i;
+	int j;
+
+	memcpy(c,ctr,8);
+	for (i=0;i<bytes;i++)
+	{
+		if ((i & 7) == 0)
+		{
+			memcpy(k,c,8);
+			ref_ecb(ks,k,1);
+			for (j=7;j>=0 && ++c[j]==0;j--)
+				;
+		}
+		p[i] ^= k[i & 7];
+	}
+}
+
+/* Check every mode at blocks blocks with random keys and data, for
+   nkeys 1 (DES), 2 or 3 (TDES) */
+static void kat_modes(des_pool *pool, int nkeys, long blocks,
+		unsigned char *src, unsigned char *got, unsigned char *want)
+{
+	des_ctx dc;
+	des3_ctx d3;
+	unsigned char key[24], iv[8], iv2[8], ivbuf[3][8], *ivs[3], *bufs[3];
+	uint32_t ek[3][32], dk[3][32], *enc[3], *dec[3];
+	int lens[3], i, third;
+	long bytes = blocks * 8;
+
+	kat_fill(key,24);
+	kat_fill(iv,8);
+	kat_fill(src,bytes);
+	if (nkeys == 2)
+		memcpy(key + 16,key,8);
+	for (i=0;i<3;i++)
+	{
+		deskey_r(key + 8 * i,EN0,ek[i]);
+		deskey_r(key + 8 * i,DE1,dk[i]);
+	}
+	if (nkeys == 1)
+	{
+		des_key(&dc,key);
+		enc[0] = ek[0]; enc[1] = NULL;
+		dec[0] = dk[0]; dec[1] = NULL;
+	} else {
+		if (nkeys == 3)
+			des3_key3(&d3,key);
+		else
+			des3_key(&d3,key);
+		enc[0] = ek[0]; enc[1] = dk[1]; enc[2] = ek[2];
+		dec[0] = dk[2]; dec[1] = ek[1]; dec[2] = dk[0];
+	}
+
+#define KAT_RUN(name, ref, call) \
+	memcpy(want,src,bytes); ref; \
+	memcpy(got,src,bytes); call; \
+	kat_cmp(name,got,want,bytes)
+
+	if (nkeys == 1)
+	{
+		KAT_RUN("des_enc",ref_ecb(enc,want,blocks),des_enc(&dc,got,blocks));
+		KAT_RUN("des_dec",ref_ecb(dec,want,blocks),des_dec(&dc,got,blocks));
+		KAT_RUN("des_pool_enc",ref_ecb(enc,want,blocks),des_pool_enc(pool,&dc,got,blocks));
+		KAT_RUN("des_pool_dec",ref_ecb(dec,want,blocks),des_pool_dec(pool,&dc,got,blocks));
+		KAT_RUN("des_cbc_enc",ref_cbc_enc(enc,iv,want,blocks),
+			memcpy(iv2,iv,8); des_cbc_enc(&dc,iv2,got,blocks));
+		KAT_RUN("des_cbc_dec",ref_cbc_dec(dec,iv,want,blocks),
+			memcpy(iv2,iv,8); des_cbc_dec(&dc,iv2,got,blocks));
+		KAT_RUN("des_pool_cbc_dec",ref_cbc_dec(dec,iv,want,blocks),
+			memcpy(iv2,iv,8); des_pool_cbc_dec(pool,&dc,iv2,got,blocks));
+		KAT_RUN("des_ctr",ref_ctr(enc,iv,want,bytes - 3),
+			memcpy(iv2,iv,8); des_ctr(&dc,iv2,got,bytes - 3));
+		KAT_RUN("des_pool_ctr",ref_ctr(enc,iv,want,bytes),
+			memcpy(iv2,iv,8); des_pool_ctr(pool,&dc,iv2,got,bytes));
+	} else {
+		KAT_RUN("des3_enc",ref_ecb(enc,want,blocks),des3_enc(&d3,got,blocks));
+		KAT_RUN("des3_dec",ref_ecb(dec,want,blocks),des3_dec(&d3,got,blocks));
+		KAT_RUN("des3_pool_enc",ref_ecb(enc,want,blocks),des3_pool_enc(pool,&d3,got,blocks));
+		KAT_RUN("des3_pool_dec",ref_ecb(dec,want,blocks),des3_pool_dec(pool,&d3,got,blocks));
+		KAT_RUN("des3_cbc_enc",ref_cbc_enc(enc,iv,want,blocks),
+			memcpy(iv2,iv,8); des3_cbc_enc(&d3,iv2,got,blocks));
+		KAT_RUN("des3_cbc_dec",ref_cbc_dec(dec,iv,want,blocks),
+			memcpy(iv2,iv,8); des3_cbc_dec(&d3,iv2,got,blocks));
+		KAT_RUN("des3_pool_cbc_dec",ref_cbc_dec(dec,iv,want,blocks),
+			memcpy(iv2,iv,8); des3_pool_cbc_dec(pool,&d3,iv2,got,blocks));
+		KAT_RUN("des3_ctr",ref_ctr(enc,iv,want,bytes - 3),
+			memcpy(iv2,iv,8); des3_ctr(&d3,iv2,got,bytes - 3));
+		KAT_RUN("des3_pool_ctr",ref_ctr(enc,iv,want,bytes),
+			memcpy(iv2,iv,8); des3_pool_ctr(pool,&d3,iv2,got,bytes));
+	}
+
+	/* Multi-stream CBC: the buffer as three streams, one IV each */
+	third = blocks / 3;
+	lens[0] = third;
+	lens[1] = blocks - 2 * third;
+	lens[2] = third;
+	memcpy(want,src,bytes);
+	memcpy(got,src,bytes);
+	for (i=0;i<3;i++)
+	{
+		ivs[i] = ivbuf[i];
+		memcpy(ivs[i],iv,8);
+		ivs[i][0] ^= i;
+		bufs[i] = got + (i == 0 ? 0 : i == 1 ? third : blocks - third) * 8;
+		ref_cbc_enc(enc,ivs[i],want + (bufs[i] - got),lens[i]);
+	}
+	if (nkeys == 1)
+		des_cbc_enc_multi(&dc,ivs,bufs,lens,3);
+	else
+		des3_cbc_enc_multi(&d3,ivs,bufs,lens,3);
+	kat_cmp(nkeys == 1 ? "des_cbc_enc_multi" : "des3_cbc_enc_multi",got,want,bytes);
+#undef KAT_RUN
+}
+
+/* Multi-key ECB: KAT_STREAMS buffers of random length (some empty,
+   some long enough for the bitsliced kernels), each with its own key,
+   for nkeys 1 (DES), 2 or 3 (TDES) */
+static void kat_multi(int nkeys, unsigned char *got, unsigned char *want)
+{
+	static des_ctx dcs[KAT_STREAMS];
+	static des3_ctx d3s[KAT_STREAMS];
+	des_ctx *dp[KAT_STREAMS];
+	des3_ctx *d3p[KAT_STREAMS];
+	unsigned char key[24], *bufs[KAT_STREAMS];
+	uint32_t ek[3][32], dk[3][32], *enc[3], *dec[3];
+	int lens[KAT_STREAMS], i, j, dir;
+	long off;
+
+	for (off=0,i=0;i<KAT_STREAMS;i++)
+	{
+		lens[i] = (i % 5 == 4) ? 64 + kat_rand() % 600 : kat_rand() % 6;
+		bufs[i] = got + off;
+		off += lens[i] * 8;
+		dp[i] = &dcs[i];
+		d3p[i] = &d3s[i];
+	}
+	kat_fill(got,off);
+	memcpy(want,got,off);
+
+	for (dir=0;dir<2;dir++)
+	{
+		for (i=0;i<KAT_STREAMS;i++)
+		{
+			kat_fill(key,24);
+			if (nkeys == 2)
+				memcpy(key + 16,key,8);
+			for (j=0;j<3;j++)
+			{
+				deskey_r(key + 8 * j,EN0,ek[j]);
+				deskey_r(key + 8 * j,DE1,dk[j]);
+			}
+			if (nkeys == 1)
+			{
+				des_key(dp[i],key);
+				enc[0] = ek[0]; enc[1] = NULL;
+				dec[0] = dk[0]; dec[1] = NULL;
+			} else {
+				if (nkeys == 3)
+					des3_key3(d3p[i],key);
+				else
+					des3_key(d3p[i],key);
+				enc[0] = ek[0]; enc[1] = dk[1]; enc[2] = ek[2];
+				dec[0] = dk[2]; dec[1] = ek[1]; dec[2] = dk[0];
+			}
+			ref_ecb(dir ? dec : enc,want + (bufs[i] - got),lens[i]);
+		}
+		if (nkeys == 1 && dir == 0)
+			des_enc_multi(dp,bufs,lens,KAT_STREAMS);
+		else if (nkeys == 1)
+			des_dec_multi(dp,bufs,lens,KAT_STREAMS);
+		else if (dir == 0)
+			des3_enc_multi(d3p,bufs,lens,KAT_STREAMS);
+		else
+			des3_dec_multi(d3p,bufs,lens,KAT_STREAMS);
+		kat_cmp(nkeys == 1 ? (dir ? "des_dec_multi" : "des_enc_multi") :
+			(dir ? "des3_dec_multi" : "des3_enc_multi"),got,want,off);
+	}
+}
+
+static void kat_kernels_check(void)
+{
+	unsigned char *src, *got, *want;
+	char saved[16], what[64];
+	des_pool *pool;
+	size_t s;
+	int k, n, c, f;
+
+	src = malloc(KAT_MAXBLOCKS * 8);
+	got = malloc(KAT_MAXBLOCKS * 8);
+	want = malloc(KAT_MAXBLOCKS * 8);
+	if (src == NULL || got == NULL || want == NULL)
+	{
+		printf("out of memory!\n");
+		kat_failed++;
+		return;
+	}
+	/* Three threads, so slices start at non-zero offsets */
+	pool = des_pool_create(3);
+
+	snprintf(saved,sizeof(saved),"%s",des_kernel_name());
+	for (k=0;kat_kernels[k]!=NULL;k++)
+	{
+		snprintf(what,sizeof(what),"kernel %s, all modes",kat_kernels[k]);
+		if (des_set_kernel(kat_kernels[k]) != 0)
+		{
+			printf("%-40s %6s %s\n",what,"-","not supported here");
+			continue;
+		}
+		c = kat_checks; f = kat_failed;
+		for (s=0;s<sizeof(kat_sizes)/sizeof(kat_sizes[0]);s++)
+			for (n=1;n<=3;n++)
+				kat_modes(pool,n,kat_sizes[s],src,got,want);
+		for (n=1;n<=3;n++)
+			kat_multi(n,got,want);
+		kat_result(what,kat_checks - c,kat_failed - f);
+	}
+	des_set_kernel(saved);
+
+	des_pool_destroy(pool);
+	free(src);
+	free(got);
+	free(want);
+}
+
+static void kat_hex_check(void)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	unsigned char bin[1024], back[1024];
+	char hex[2048], want[2048], saved[16], what[64];
+	int h, n, i, c, f;
+
+	snprintf(saved,sizeof(saved),"%s",des_hex_impl());
+	for (h=0;kat_hexes[h]!=NULL;h++)
+	{
+		snprintf(what,sizeof(what),"hex codec %s",kat_hexes[h]);
+		if (des_hex_set_impl(kat_hexes[h]) != 0)
+		{
+			printf("%-40s %6s %s\n",what,"-","not supported here");
+			continue;
+		}
+		c = kat_checks; f = kat_failed;
+		for (n=0;n<=(int)sizeof(bin);n+=(n < 80 ? 1 : 97))
+		{
+			kat_fill(bin,n);
+			for (i=0;i<n;i++)
+			{
+				want[2 * i] = digits[bin[i] >> 4];
+				want[2 * i + 1] = digits[bin[i] & 0x0f];
+			}
+			des_hex_encode(bin,hex,n);
+			kat_cmp("des_hex_encode",(unsigned char *)hex,(unsigned char *)want,2 * n);
+			for (i=0;i<2*n;i++)	/* mixed case */
+				if (hex[i] > '9' && (kat_rand() & 1))
+					hex[i] |= 0x20;
+			kat_checks++;
+			if (des_hex_decode(hex,back,n) != 0 && kat_failed++ < KAT_SHOW)
+				printf("  MISMATCH des_hex_decode rejected good hex, %d bytes\n",n);
+			kat_cmp("des_hex_decode",back,bin,n);
+			if (n > 0)
+			{
+				hex[kat_rand() % (2 * n)] = "g/:@`G \x80"[kat_rand() % 8];
+				kat_checks++;
+				if (des_hex_decode(hex,back,n) == 0 && kat_failed++ < KAT_SHOW)
+					printf("  MISMATCH des_hex_decode took bad hex, %d bytes\n",n);
+			}
+		}
+		kat_result(what,kat_checks - c,kat_failed - f);
+	}
+	des_hex_set_impl(saved);
+}
+
+/* Run all the checks, printing one line per group. Returns 0 if
+ * everything matched, 1 otherwise.
+ */
+int do_kat(void)
+{
+	kat_checks = kat_failed = 0;
+	kat_tables();
+	kat_monte_carlo();
+	kat_kernels_check();
+	kat_hex_check();
+
+	if (kat_failed)
+	{
+		printf("%d of %d checks FAILED\n",kat_failed,kat_checks);
+		return(1);
+	}
+	printf("All %d checks passed\n",kat_checks);
+	return(0);
+}